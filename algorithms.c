@@ -1,166 +1,2742 @@
+#define _GNU_SOURCE
+
 #include "algorithms.h"
 
 #include <assert.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define ARRAY_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+#ifdef __GNUC__
+#define ARRAY_PREFETCH(address) __builtin_prefetch(address)
+#else
+#define ARRAY_PREFETCH(address) ((void) (address))
+#endif
 
-const int A = 2;
+/*
+ * kernels
+ */
 
-void array_create(struct array *self) {
-    self->size = 0;
-    self->capacity = 10;
-    self->data = calloc(10, sizeof(int));
+#ifndef ARRAY_SORT_SMALL_THRESHOLD_AVX2
+#define ARRAY_SORT_SMALL_THRESHOLD_AVX2 64
+#endif
+#ifndef ARRAY_SORT_SMALL_THRESHOLD_AVX512
+#define ARRAY_SORT_SMALL_THRESHOLD_AVX512 128
+#endif
+
+struct array_kernels {
+    size_t (*find)(const int *data, size_t size, int value);
+    size_t (*count)(const int *data, size_t size, int value);
+    size_t (*argmax4)(const int *data);
+    size_t (*argmax8)(const int *data);
+    bool (*is_sorted)(const int *data, size_t size);
+    bool (*equals)(const int *data, const int *other, size_t size);
+    size_t (*is_heap_until)(const int *data, size_t size);
+    void (*sort_small)(int *data, size_t size);
+    // largest range the sort routines hand to sort_small instead of their insertion sort
+    size_t sort_small_threshold;
+};
+
+size_t array_find_scalar(const int *data, size_t size, int value) {
+    size_t i = 0;
+    for (; i < size; i++) {
+        if (data[i] == value) return i;
+    }
+    return i;
+}
+
+size_t array_count_scalar(const int *data, size_t size, int value) {
+    size_t count = 0;
+    for (size_t i = 0; i < size; i++) count += data[i] == value;
+    return count;
+}
+
+/*
+ * Index of the first maximum among size values
+ */
+size_t array_argmax_scalar(const int *data, size_t size) {
+    size_t best = 0;
+    for (size_t i = 1; i < size; i++) {
+        if (data[best] < data[i]) best = i;
+    }
+    return best;
+}
+
+size_t array_argmax4_scalar(const int *data) {
+    return array_argmax_scalar(data, 4);
+}
+
+size_t array_argmax8_scalar(const int *data) {
+    return array_argmax_scalar(data, 8);
+}
+
+bool array_is_sorted_scalar(const int *data, size_t size) {
+    for (size_t i = 1; i < size; i++) {
+        if (data[i - 1] > data[i]) return false;
+    }
+    return true;
+}
+
+bool array_equals_scalar(const int *data, const int *other, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        if (data[i] != other[i]) return false;
+    }
+    return true;
+}
+
+/*
+ * Index of the first element greater than its parent in a binary max-heap, starting at child first
+ */
+size_t array_is_heap_until_scalar_from(const int *data, size_t size, size_t first) {
+    for (size_t i = first; i < size; i++) {
+        if (data[(i - 1) / 2] < data[i]) return i;
+    }
+    return size;
+}
+
+size_t array_is_heap_until_scalar(const int *data, size_t size) {
+    return array_is_heap_until_scalar_from(data, size, 1);
+}
+
+void array_insertion_sort(int *begin, int *end);
+
+void array_sort_small_scalar(int *data, size_t size) {
+    array_insertion_sort(data, data + size);
+}
+
+const struct array_kernels array_kernels_scalar = {
+    array_find_scalar, array_count_scalar, array_argmax4_scalar, array_argmax8_scalar,
+    array_is_sorted_scalar, array_equals_scalar, array_is_heap_until_scalar,
+    array_sort_small_scalar, 0,
+};
+
+#ifdef ARRAY_X86_KERNELS
+
+__attribute__((target("sse4.2")))
+size_t array_find_sse42(const int *data, size_t size, int value) {
+    const __m128i needle = _mm_set1_epi32(value);
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m128i eq0 = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *) (data + i)), needle);
+        __m128i eq1 = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *) (data + i + 4)), needle);
+        __m128i eq2 = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *) (data + i + 8)), needle);
+        __m128i eq3 = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *) (data + i + 12)), needle);
+        __m128i any = _mm_or_si128(_mm_or_si128(eq0, eq1), _mm_or_si128(eq2, eq3));
+        if (_mm_testz_si128(any, any)) continue;
+        unsigned mask = (unsigned) _mm_movemask_ps(_mm_castsi128_ps(eq0))
+            | (unsigned) _mm_movemask_ps(_mm_castsi128_ps(eq1)) << 4
+            | (unsigned) _mm_movemask_ps(_mm_castsi128_ps(eq2)) << 8
+            | (unsigned) _mm_movemask_ps(_mm_castsi128_ps(eq3)) << 12;
+        return i + (size_t) __builtin_ctz(mask);
+    }
+    for (; i + 4 <= size; i += 4) {
+        __m128i eq = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *) (data + i)), needle);
+        unsigned mask = (unsigned) _mm_movemask_ps(_mm_castsi128_ps(eq));
+        if (mask != 0) return i + (size_t) __builtin_ctz(mask);
+    }
+    return i + array_find_scalar(data + i, size - i, value);
+}
+
+__attribute__((target("sse4.2,popcnt")))
+size_t array_count_sse42(const int *data, size_t size, int value) {
+    const __m128i needle = _mm_set1_epi32(value);
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + 4 <= size; i += 4) {
+        __m128i eq = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *) (data + i)), needle);
+        count += (size_t) __builtin_popcount((unsigned) _mm_movemask_ps(_mm_castsi128_ps(eq)));
+    }
+    return count + array_count_scalar(data + i, size - i, value);
+}
+
+__attribute__((target("avx2")))
+size_t array_find_avx2(const int *data, size_t size, int value) {
+    const __m256i needle = _mm256_set1_epi32(value);
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        __m256i eq0 = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i *) (data + i)), needle);
+        __m256i eq1 = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i *) (data + i + 8)), needle);
+        __m256i eq2 = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i *) (data + i + 16)), needle);
+        __m256i eq3 = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i *) (data + i + 24)), needle);
+        __m256i any = _mm256_or_si256(_mm256_or_si256(eq0, eq1), _mm256_or_si256(eq2, eq3));
+        if (_mm256_testz_si256(any, any)) continue;
+        unsigned long long mask = (unsigned long long) (unsigned) _mm256_movemask_ps(_mm256_castsi256_ps(eq0))
+            | (unsigned long long) (unsigned) _mm256_movemask_ps(_mm256_castsi256_ps(eq1)) << 8
+            | (unsigned long long) (unsigned) _mm256_movemask_ps(_mm256_castsi256_ps(eq2)) << 16
+            | (unsigned long long) (unsigned) _mm256_movemask_ps(_mm256_castsi256_ps(eq3)) << 24;
+        return i + (size_t) __builtin_ctzll(mask);
+    }
+    for (; i + 8 <= size; i += 8) {
+        __m256i eq = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i *) (data + i)), needle);
+        unsigned mask = (unsigned) _mm256_movemask_ps(_mm256_castsi256_ps(eq));
+        if (mask != 0) return i + (size_t) __builtin_ctz(mask);
+    }
+    return i + array_find_scalar(data + i, size - i, value);
+}
+
+__attribute__((target("avx2,popcnt")))
+size_t array_count_avx2(const int *data, size_t size, int value) {
+    const __m256i needle = _mm256_set1_epi32(value);
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        __m256i eq = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i *) (data + i)), needle);
+        count += (size_t) __builtin_popcount((unsigned) _mm256_movemask_ps(_mm256_castsi256_ps(eq)));
+    }
+    return count + array_count_scalar(data + i, size - i, value);
+}
+
+__attribute__((target("avx512f")))
+size_t array_find_avx512(const int *data, size_t size, int value) {
+    const __m512i needle = _mm512_set1_epi32(value);
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __mmask16 mask = _mm512_cmpeq_epi32_mask(_mm512_loadu_si512(data + i), needle);
+        if (mask != 0) return i + (size_t) __builtin_ctz(mask);
+    }
+    if (i < size) {
+        __mmask16 tail = (__mmask16) ((1u << (size - i)) - 1);
+        __mmask16 mask = _mm512_mask_cmpeq_epi32_mask(tail, _mm512_maskz_loadu_epi32(tail, data + i), needle);
+        if (mask != 0) return i + (size_t) __builtin_ctz(mask);
+    }
+    return size;
+}
+
+__attribute__((target("avx512f,popcnt")))
+size_t array_count_avx512(const int *data, size_t size, int value) {
+    const __m512i needle = _mm512_set1_epi32(value);
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        count += (size_t) __builtin_popcount(_mm512_cmpeq_epi32_mask(_mm512_loadu_si512(data + i), needle));
+    }
+    if (i < size) {
+        __mmask16 tail = (__mmask16) ((1u << (size - i)) - 1);
+        count += (size_t) __builtin_popcount(_mm512_mask_cmpeq_epi32_mask(tail, _mm512_maskz_loadu_epi32(tail, data + i), needle));
+    }
+    return count;
+}
+
+/*
+ * Broadcast the maximum of the four lanes to every lane
+ */
+__attribute__((target("sse4.2")))
+__m128i array_hmax_sse42(__m128i v) {
+    v = _mm_max_epi32(v, _mm_shuffle_epi32(v, 0x4E));
+    return _mm_max_epi32(v, _mm_shuffle_epi32(v, 0xB1));
+}
+
+__attribute__((target("sse4.2")))
+size_t array_argmax4_sse42(const int *data) {
+    __m128i v = _mm_loadu_si128((const __m128i *) data);
+    __m128i eq = _mm_cmpeq_epi32(v, array_hmax_sse42(v));
+    return (size_t) __builtin_ctz((unsigned) _mm_movemask_ps(_mm_castsi128_ps(eq)));
+}
+
+__attribute__((target("sse4.2")))
+size_t array_argmax8_sse42(const int *data) {
+    __m128i low = _mm_loadu_si128((const __m128i *) data);
+    __m128i high = _mm_loadu_si128((const __m128i *) (data + 4));
+    __m128i max = array_hmax_sse42(_mm_max_epi32(low, high));
+    unsigned mask = (unsigned) _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(low, max)))
+        | (unsigned) _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(high, max))) << 4;
+    return (size_t) __builtin_ctz(mask);
+}
+
+__attribute__((target("avx2")))
+size_t array_argmax8_avx2(const int *data) {
+    __m256i v = _mm256_loadu_si256((const __m256i *) data);
+    __m256i max = _mm256_max_epi32(v, _mm256_permute2x128_si256(v, v, 1));
+    max = _mm256_max_epi32(max, _mm256_shuffle_epi32(max, 0x4E));
+    max = _mm256_max_epi32(max, _mm256_shuffle_epi32(max, 0xB1));
+    __m256i eq = _mm256_cmpeq_epi32(v, max);
+    return (size_t) __builtin_ctz((unsigned) _mm256_movemask_ps(_mm256_castsi256_ps(eq)));
+}
+
+/*
+ * The array is sorted when no element is greater than its successor: compare a window of elements
+ * with the same window shifted by one
+ */
+__attribute__((target("sse4.2")))
+bool array_is_sorted_sse42(const int *data, size_t size) {
+    size_t i = 0;
+    for (; i + 8 < size; i += 8) {
+        __m128i gt0 = _mm_cmpgt_epi32(_mm_loadu_si128((const __m128i *) (data + i)), _mm_loadu_si128((const __m128i *) (data + i + 1)));
+        __m128i gt1 = _mm_cmpgt_epi32(_mm_loadu_si128((const __m128i *) (data + i + 4)), _mm_loadu_si128((const __m128i *) (data + i + 5)));
+        __m128i any = _mm_or_si128(gt0, gt1);
+        if (!_mm_testz_si128(any, any)) return false;
+    }
+    return array_is_sorted_scalar(data + i, size - i);
+}
+
+__attribute__((target("sse4.2")))
+bool array_equals_sse42(const int *data, const int *other, size_t size) {
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m128i diff = _mm_xor_si128(_mm_loadu_si128((const __m128i *) (data + i)), _mm_loadu_si128((const __m128i *) (other + i)));
+        diff = _mm_or_si128(diff, _mm_xor_si128(_mm_loadu_si128((const __m128i *) (data + i + 4)), _mm_loadu_si128((const __m128i *) (other + i + 4))));
+        diff = _mm_or_si128(diff, _mm_xor_si128(_mm_loadu_si128((const __m128i *) (data + i + 8)), _mm_loadu_si128((const __m128i *) (other + i + 8))));
+        diff = _mm_or_si128(diff, _mm_xor_si128(_mm_loadu_si128((const __m128i *) (data + i + 12)), _mm_loadu_si128((const __m128i *) (other + i + 12))));
+        if (!_mm_testz_si128(diff, diff)) return false;
+    }
+    return array_equals_scalar(data + i, other + i, size - i);
+}
+
+__attribute__((target("avx2")))
+bool array_is_sorted_avx2(const int *data, size_t size) {
+    size_t i = 0;
+    for (; i + 16 < size; i += 16) {
+        __m256i gt0 = _mm256_cmpgt_epi32(_mm256_loadu_si256((const __m256i *) (data + i)), _mm256_loadu_si256((const __m256i *) (data + i + 1)));
+        __m256i gt1 = _mm256_cmpgt_epi32(_mm256_loadu_si256((const __m256i *) (data + i + 8)), _mm256_loadu_si256((const __m256i *) (data + i + 9)));
+        __m256i any = _mm256_or_si256(gt0, gt1);
+        if (!_mm256_testz_si256(any, any)) return false;
+    }
+    return array_is_sorted_scalar(data + i, size - i);
+}
+
+__attribute__((target("avx2")))
+bool array_equals_avx2(const int *data, const int *other, size_t size) {
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        __m256i diff = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *) (data + i)), _mm256_loadu_si256((const __m256i *) (other + i)));
+        diff = _mm256_or_si256(diff, _mm256_xor_si256(_mm256_loadu_si256((const __m256i *) (data + i + 8)), _mm256_loadu_si256((const __m256i *) (other + i + 8))));
+        diff = _mm256_or_si256(diff, _mm256_xor_si256(_mm256_loadu_si256((const __m256i *) (data + i + 16)), _mm256_loadu_si256((const __m256i *) (other + i + 16))));
+        diff = _mm256_or_si256(diff, _mm256_xor_si256(_mm256_loadu_si256((const __m256i *) (data + i + 24)), _mm256_loadu_si256((const __m256i *) (other + i + 24))));
+        if (!_mm256_testz_si256(diff, diff)) return false;
+    }
+    return array_equals_scalar(data + i, other + i, size - i);
+}
+
+__attribute__((target("avx512f")))
+bool array_is_sorted_avx512(const int *data, size_t size) {
+    size_t i = 0;
+    for (; i + 16 < size; i += 16) {
+        if (_mm512_cmpgt_epi32_mask(_mm512_loadu_si512(data + i), _mm512_loadu_si512(data + i + 1)) != 0) return false;
+    }
+    return array_is_sorted_scalar(data + i, size - i);
+}
+
+__attribute__((target("avx512f")))
+bool array_equals_avx512(const int *data, const int *other, size_t size) {
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        if (_mm512_cmpneq_epi32_mask(_mm512_loadu_si512(data + i), _mm512_loadu_si512(other + i)) != 0) return false;
+    }
+    if (i < size) {
+        __mmask16 tail = (__mmask16) ((1u << (size - i)) - 1);
+        __m512i a = _mm512_maskz_loadu_epi32(tail, data + i);
+        __m512i b = _mm512_maskz_loadu_epi32(tail, other + i);
+        if (_mm512_cmpneq_epi32_mask(a, b) != 0) return false;
+    }
+    return true;
+}
+
+/*
+ * The children of parents p, p + 1, ... are the contiguous elements 2p + 1, 2p + 2, ..., so duplicating
+ * every parent lane lines the parents up with their children. On a violation, the scalar loop finds its exact index.
+ */
+__attribute__((target("sse4.2")))
+size_t array_is_heap_until_sse42(const int *data, size_t size) {
+    size_t parent = 0;
+    for (; 2 * parent + 4 < size; parent += 2) {
+        __m128i parents = _mm_shuffle_epi32(_mm_loadl_epi64((const __m128i *) (data + parent)), 0x50);
+        __m128i children = _mm_loadu_si128((const __m128i *) (data + 2 * parent + 1));
+        __m128i gt = _mm_cmpgt_epi32(children, parents);
+        if (!_mm_testz_si128(gt, gt)) break;
+    }
+    return array_is_heap_until_scalar_from(data, size, 2 * parent + 1);
+}
+
+__attribute__((target("avx2")))
+size_t array_is_heap_until_avx2(const int *data, size_t size) {
+    const __m256i duplicate = _mm256_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3);
+    size_t parent = 0;
+    for (; 2 * parent + 8 < size; parent += 4) {
+        __m256i parents = _mm256_permutevar8x32_epi32(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *) (data + parent))), duplicate);
+        __m256i children = _mm256_loadu_si256((const __m256i *) (data + 2 * parent + 1));
+        __m256i gt = _mm256_cmpgt_epi32(children, parents);
+        if (!_mm256_testz_si256(gt, gt)) break;
+    }
+    return array_is_heap_until_scalar_from(data, size, 2 * parent + 1);
+}
+
+__attribute__((target("avx512f")))
+size_t array_is_heap_until_avx512(const int *data, size_t size) {
+    const __m512i duplicate = _mm512_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7);
+    size_t parent = 0;
+    for (; 2 * parent + 16 < size; parent += 8) {
+        __m512i parents = _mm512_permutexvar_epi32(duplicate, _mm512_castsi256_si512(_mm256_loadu_si256((const __m256i *) (data + parent))));
+        __m512i children = _mm512_loadu_si512(data + 2 * parent + 1);
+        if (_mm512_cmpgt_epi32_mask(children, parents) != 0) break;
+    }
+    return array_is_heap_until_scalar_from(data, size, 2 * parent + 1);
+}
+
+/*
+ * Sorting networks for small blocks: the block is padded with INT_MAX to a power of two number of vectors
+ * and sorted with a bitonic network where every compare-exchange sends the minimum to the lower index,
+ * the first step of each merge comparing mirrored positions instead of alternating the directions.
+ * Exchanges between lanes of a vector pair every lane with the lane whose index differs by the bits of
+ * partner, and keep the maximum in the lanes having the bit upper set.
+ */
+__attribute__((target("avx2")))
+__m256i array_exchange_lanes_avx2(__m256i v, int partner, int upper) {
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    __m256i other = _mm256_permutevar8x32_epi32(v, _mm256_xor_si256(lanes, _mm256_set1_epi32(partner)));
+    __m256i high = _mm256_cmpeq_epi32(_mm256_and_si256(lanes, _mm256_set1_epi32(upper)), _mm256_set1_epi32(upper));
+    return _mm256_blendv_epi8(_mm256_min_epi32(v, other), _mm256_max_epi32(v, other), high);
+}
+
+__attribute__((target("avx2")))
+void array_sort_small_avx2(int *data, size_t size) {
+    if (size < 2) return;
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i reverse = _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+    const __m256i padding = _mm256_set1_epi32(INT_MAX);
+    __m256i v[ARRAY_SORT_SMALL_MAX / 8];
+    size_t count = 1;
+    while (8 * count < size) count *= 2;
+
+    for (size_t i = 0; i < count; i++) {
+        if (8 * i + 8 <= size) {
+            v[i] = _mm256_loadu_si256((const __m256i *) (data + 8 * i));
+        }
+        else if (8 * i < size) {
+            __m256i mask = _mm256_cmpgt_epi32(_mm256_set1_epi32((int) (size - 8 * i)), lanes);
+            v[i] = _mm256_blendv_epi8(padding, _mm256_maskload_epi32(data + 8 * i, mask), mask);
+        }
+        else {
+            v[i] = padding;
+        }
+    }
+
+    for (size_t k = 2; k <= 8 * count; k *= 2) {
+        if (k <= 8) {
+            for (size_t i = 0; i < count; i++) v[i] = array_exchange_lanes_avx2(v[i], (int) k - 1, (int) k / 2);
+        }
+        else {
+            size_t span = k / 8;
+            for (size_t block = 0; block < count; block += span) {
+                for (size_t i = 0; i < span / 2; i++) {
+                    __m256i *a = v + block + i;
+                    __m256i *b = v + block + span - 1 - i;
+                    __m256i mirrored = _mm256_permutevar8x32_epi32(*b, reverse);
+                    __m256i max = _mm256_max_epi32(*a, mirrored);
+                    *a = _mm256_min_epi32(*a, mirrored);
+                    *b = _mm256_permutevar8x32_epi32(max, reverse);
+                }
+            }
+        }
+        for (size_t j = k / 4; j >= 8; j /= 2) {
+            size_t span = j / 8;
+            for (size_t i = 0; i < count; i++) {
+                if (i & span) continue;
+                __m256i max = _mm256_max_epi32(v[i], v[i + span]);
+                v[i] = _mm256_min_epi32(v[i], v[i + span]);
+                v[i + span] = max;
+            }
+        }
+        for (int j = (int) (k / 4 < 4 ? k / 4 : 4); j >= 1; j /= 2) {
+            for (size_t i = 0; i < count; i++) v[i] = array_exchange_lanes_avx2(v[i], j, j);
+        }
+    }
+
+    for (size_t i = 0; 8 * i < size; i++) {
+        if (8 * i + 8 <= size) {
+            _mm256_storeu_si256((__m256i *) (data + 8 * i), v[i]);
+        }
+        else {
+            __m256i mask = _mm256_cmpgt_epi32(_mm256_set1_epi32((int) (size - 8 * i)), lanes);
+            _mm256_maskstore_epi32(data + 8 * i, mask, v[i]);
+        }
+    }
+}
+
+__attribute__((target("avx512f")))
+__m512i array_exchange_lanes_avx512(__m512i v, int partner, int upper) {
+    const __m512i lanes = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    __m512i other = _mm512_permutexvar_epi32(_mm512_xor_si512(lanes, _mm512_set1_epi32(partner)), v);
+    __mmask16 high = _mm512_test_epi32_mask(lanes, _mm512_set1_epi32(upper));
+    return _mm512_mask_blend_epi32(high, _mm512_min_epi32(v, other), _mm512_max_epi32(v, other));
+}
+
+__attribute__((target("avx512f")))
+void array_sort_small_avx512(int *data, size_t size) {
+    if (size < 2) return;
+    const __m512i reverse = _mm512_setr_epi32(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+    const __m512i padding = _mm512_set1_epi32(INT_MAX);
+    __m512i v[ARRAY_SORT_SMALL_MAX / 16];
+    size_t count = 1;
+    while (16 * count < size) count *= 2;
+
+    for (size_t i = 0; i < count; i++) {
+        if (16 * i + 16 <= size) {
+            v[i] = _mm512_loadu_si512(data + 16 * i);
+        }
+        else if (16 * i < size) {
+            __mmask16 mask = (__mmask16) ((1u << (size - 16 * i)) - 1);
+            v[i] = _mm512_mask_loadu_epi32(padding, mask, data + 16 * i);
+        }
+        else {
+            v[i] = padding;
+        }
+    }
+
+    for (size_t k = 2; k <= 16 * count; k *= 2) {
+        if (k <= 16) {
+            for (size_t i = 0; i < count; i++) v[i] = array_exchange_lanes_avx512(v[i], (int) k - 1, (int) k / 2);
+        }
+        else {
+            size_t span = k / 16;
+            for (size_t block = 0; block < count; block += span) {
+                for (size_t i = 0; i < span / 2; i++) {
+                    __m512i *a = v + block + i;
+                    __m512i *b = v + block + span - 1 - i;
+                    __m512i mirrored = _mm512_permutexvar_epi32(reverse, *b);
+                    __m512i max = _mm512_max_epi32(*a, mirrored);
+                    *a = _mm512_min_epi32(*a, mirrored);
+                    *b = _mm512_permutexvar_epi32(reverse, max);
+                }
+            }
+        }
+        for (size_t j = k / 4; j >= 16; j /= 2) {
+            size_t span = j / 16;
+            for (size_t i = 0; i < count; i++) {
+                if (i & span) continue;
+                __m512i max = _mm512_max_epi32(v[i], v[i + span]);
+                v[i] = _mm512_min_epi32(v[i], v[i + span]);
+                v[i + span] = max;
+            }
+        }
+        for (int j = (int) (k / 4 < 8 ? k / 4 : 8); j >= 1; j /= 2) {
+            for (size_t i = 0; i < count; i++) v[i] = array_exchange_lanes_avx512(v[i], j, j);
+        }
+    }
+
+    for (size_t i = 0; 16 * i < size; i++) {
+        if (16 * i + 16 <= size) {
+            _mm512_storeu_si512(data + 16 * i, v[i]);
+        }
+        else {
+            __mmask16 mask = (__mmask16) ((1u << (size - 16 * i)) - 1);
+            _mm512_mask_storeu_epi32(data + 16 * i, mask, v[i]);
+        }
+    }
+}
+
+const struct array_kernels array_kernels_sse42 = {
+    array_find_sse42, array_count_sse42, array_argmax4_sse42, array_argmax8_sse42,
+    array_is_sorted_sse42, array_equals_sse42, array_is_heap_until_sse42,
+    array_sort_small_scalar, 0,
+};
+const struct array_kernels array_kernels_avx2 = {
+    array_find_avx2, array_count_avx2, array_argmax4_sse42, array_argmax8_avx2,
+    array_is_sorted_avx2, array_equals_avx2, array_is_heap_until_avx2,
+    array_sort_small_avx2, ARRAY_SORT_SMALL_THRESHOLD_AVX2,
+};
+const struct array_kernels array_kernels_avx512 = {
+    array_find_avx512, array_count_avx512, array_argmax4_sse42, array_argmax8_avx2,
+    array_is_sorted_avx512, array_equals_avx512, array_is_heap_until_avx512,
+    array_sort_small_avx512, ARRAY_SORT_SMALL_THRESHOLD_AVX512,
+};
+
+#endif
+
+const struct array_kernels *array_kernels_current = NULL;
+enum array_simd array_simd_current = ARRAY_SIMD_SCALAR;
+
+enum array_simd array_simd_supported(void) {
+#ifdef ARRAY_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return ARRAY_SIMD_AVX512;
+    if (__builtin_cpu_supports("avx2")) return ARRAY_SIMD_AVX2;
+    if (__builtin_cpu_supports("sse4.2")) return ARRAY_SIMD_SSE42;
+#endif
+    return ARRAY_SIMD_SCALAR;
+}
+
+enum array_simd array_set_simd(enum array_simd simd) {
+    enum array_simd supported = array_simd_supported();
+    if (simd > supported) simd = supported;
+    switch (simd) {
+#ifdef ARRAY_X86_KERNELS
+        case ARRAY_SIMD_AVX512: array_kernels_current = &array_kernels_avx512; break;
+        case ARRAY_SIMD_AVX2: array_kernels_current = &array_kernels_avx2; break;
+        case ARRAY_SIMD_SSE42: array_kernels_current = &array_kernels_sse42; break;
+#endif
+        default: array_kernels_current = &array_kernels_scalar; break;
+    }
+    array_simd_current = simd;
+    return simd;
+}
+
+pthread_once_t array_kernels_once = PTHREAD_ONCE_INIT;
+
+/*
+ * Pick the best kernels the CPU supports, unless array_set_simd already chose some
+ */
+void array_kernels_init(void) {
+    if (array_kernels_current == NULL) array_set_simd(ARRAY_SIMD_AVX512);
+}
+
+enum array_simd array_get_simd(void) {
+    pthread_once(&array_kernels_once, array_kernels_init);
+    return array_simd_current;
+}
+
+const struct array_kernels *array_kernels(void) {
+    // resolved once, so that threads making their first array calls at the same time do not race
+    pthread_once(&array_kernels_once, array_kernels_init);
+    return array_kernels_current;
+}
+
+bool array_set_capacity(struct array *self, size_t capacity);
+void array_capacity_failure(size_t capacity);
+bool array_is_inline(const struct array *self);
+void array_select_range(int *begin, int *end, int *nth, int badAllowed, bool leftmost);
+
+/*
+ * allocators
+ */
+
+void *array_malloc_alloc(void *context, size_t size) {
+    (void) context;
+    return malloc(size);
+}
+
+void *array_malloc_realloc(void *context, void *ptr, size_t oldSize, size_t newSize) {
+    (void) context;
+    (void) oldSize;
+    return realloc(ptr, newSize);
+}
+
+void array_malloc_free(void *context, void *ptr, size_t size) {
+    (void) context;
+    (void) size;
+    free(ptr);
+}
+
+const struct array_allocator array_malloc_allocator = {
+    array_malloc_alloc, array_malloc_realloc, array_malloc_free, NULL,
+};
+
+const struct array_allocator *array_default_allocator = &array_malloc_allocator;
+
+void array_set_default_allocator(const struct array_allocator *allocator) {
+    array_default_allocator = allocator == NULL ? &array_malloc_allocator : allocator;
+}
+
+#define ARRAY_ARENA_ALIGNMENT 16
+
+struct array_arena_chunk {
+    struct array_arena_chunk *next;
+    size_t capacity;
+    size_t used;
+    size_t last;
+};
+
+size_t array_arena_align(size_t size) {
+    return (size + ARRAY_ARENA_ALIGNMENT - 1) / ARRAY_ARENA_ALIGNMENT * ARRAY_ARENA_ALIGNMENT;
+}
+
+char *array_arena_chunk_data(struct array_arena_chunk *chunk) {
+    return (char *) chunk + array_arena_align(sizeof(struct array_arena_chunk));
+}
+
+void *array_arena_alloc(void *context, size_t size) {
+    struct array_arena *arena = context;
+    struct array_arena_chunk *chunk = arena->chunks;
+    size = array_arena_align(size);
+    if (chunk == NULL || chunk->capacity - chunk->used < size) {
+        size_t capacity = size > arena->chunkSize ? size : arena->chunkSize;
+        chunk = malloc(array_arena_align(sizeof(struct array_arena_chunk)) + capacity);
+        if (chunk == NULL) return NULL;
+        chunk->next = arena->chunks;
+        chunk->capacity = capacity;
+        chunk->used = 0;
+        chunk->last = 0;
+        arena->chunks = chunk;
+    }
+    chunk->last = chunk->used;
+    chunk->used += size;
+    return array_arena_chunk_data(chunk) + chunk->last;
+}
+
+/*
+ * Tell if ptr is the most recent allocation of the arena, which can be resized or given back in place
+ */
+bool array_arena_is_last(const struct array_arena *arena, const void *ptr) {
+    struct array_arena_chunk *chunk = arena->chunks;
+    return chunk != NULL && ptr == array_arena_chunk_data(chunk) + chunk->last;
+}
+
+void *array_arena_realloc(void *context, void *ptr, size_t oldSize, size_t newSize) {
+    struct array_arena *arena = context;
+    if (ptr == NULL) return array_arena_alloc(arena, newSize);
+    if (array_arena_is_last(arena, ptr)) {
+        struct array_arena_chunk *chunk = arena->chunks;
+        size_t size = array_arena_align(newSize);
+        if (chunk->capacity - chunk->last >= size) {
+            chunk->used = chunk->last + size;
+            return ptr;
+        }
+    }
+    void *data = array_arena_alloc(arena, newSize);
+    if (data != NULL) memcpy(data, ptr, oldSize < newSize ? oldSize : newSize);
+    return data;
+}
+
+void array_arena_free(void *context, void *ptr, size_t size) {
+    struct array_arena *arena = context;
+    (void) size;
+    if (array_arena_is_last(arena, ptr)) arena->chunks->used = arena->chunks->last;
+}
+
+void array_arena_create(struct array_arena *self, size_t chunkSize) {
+    self->allocator.alloc = array_arena_alloc;
+    self->allocator.realloc = array_arena_realloc;
+    self->allocator.free = array_arena_free;
+    self->allocator.context = self;
+    self->chunkSize = chunkSize == 0 ? 65536 : chunkSize;
+    self->chunks = NULL;
+}
+
+void array_arena_destroy(struct array_arena *self) {
+    struct array_arena_chunk *chunk = self->chunks;
+    while (chunk != NULL) {
+        struct array_arena_chunk *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    self->chunks = NULL;
+}
+
+void array_arena_reset(struct array_arena *self) {
+    if (self->chunks == NULL) return;
+    // keep the most recent chunk for the next round of allocations
+    struct array_arena_chunk *kept = self->chunks;
+    self->chunks = kept->next;
+    array_arena_destroy(self);
+    kept->next = NULL;
+    kept->used = 0;
+    kept->last = 0;
+    self->chunks = kept;
+}
+
+const struct array_allocator *array_arena_allocator(struct array_arena *self) {
+    return &self->allocator;
+}
+
+/*
+ * Every block of the aligned allocator starts with one cache line holding its header, so that the data
+ * that follows keeps the alignment of the block
+ */
+
+#define ARRAY_CACHE_LINE 64
+#define ARRAY_HUGE_PAGE_SIZE ((size_t) 2 * 1024 * 1024)
+
+struct array_aligned_header {
+    void *mapping;
+    size_t mappingSize;
+};
+
+struct array_aligned_header *array_aligned_header(void *ptr) {
+    return (struct array_aligned_header *) ((char *) ptr - ARRAY_CACHE_LINE);
+}
+
+/*
+ * Map a block aligned on a huge page boundary and ask for transparent huge pages, or return NULL
+ */
+void *array_aligned_map(size_t size) {
+    size_t length = (size + ARRAY_CACHE_LINE + ARRAY_HUGE_PAGE_SIZE - 1) / ARRAY_HUGE_PAGE_SIZE * ARRAY_HUGE_PAGE_SIZE;
+    char *mapping = mmap(NULL, length + ARRAY_HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED) return NULL;
+    // trim the mapping so that it starts on a huge page boundary
+    size_t head = (ARRAY_HUGE_PAGE_SIZE - (uintptr_t) mapping % ARRAY_HUGE_PAGE_SIZE) % ARRAY_HUGE_PAGE_SIZE;
+    if (head > 0) munmap(mapping, head);
+    munmap(mapping + head + length, ARRAY_HUGE_PAGE_SIZE - head);
+    mapping += head;
+#ifdef MADV_HUGEPAGE
+    madvise(mapping, length, MADV_HUGEPAGE); // only a hint: small pages are fine if huge pages are unavailable
+#endif
+    struct array_aligned_header *header = (struct array_aligned_header *) mapping;
+    header->mapping = mapping;
+    header->mappingSize = length;
+    return mapping + ARRAY_CACHE_LINE;
+}
+
+void *array_aligned_alloc(void *context, size_t size) {
+    const struct array_aligned_allocator *allocator = context;
+    if (size >= allocator->hugePageThreshold) {
+        void *data = array_aligned_map(size);
+        if (data != NULL) return data;
+    }
+    void *block;
+    if (posix_memalign(&block, ARRAY_CACHE_LINE, size + ARRAY_CACHE_LINE) != 0) return NULL;
+    struct array_aligned_header *header = block;
+    header->mapping = NULL;
+    header->mappingSize = 0;
+    return (char *) block + ARRAY_CACHE_LINE;
+}
+
+void array_aligned_free(void *context, void *ptr, size_t size) {
+    (void) context;
+    (void) size;
+    if (ptr == NULL) return;
+    struct array_aligned_header *header = array_aligned_header(ptr);
+    if (header->mapping != NULL) munmap(header->mapping, header->mappingSize);
+    else free(header);
+}
+
+void *array_aligned_realloc(void *context, void *ptr, size_t oldSize, size_t newSize) {
+    const struct array_aligned_allocator *allocator = context;
+    if (ptr == NULL) return array_aligned_alloc(context, newSize);
+    struct array_aligned_header *header = array_aligned_header(ptr);
+    if (header->mapping != NULL && newSize >= allocator->hugePageThreshold) {
+        if (newSize + ARRAY_CACHE_LINE <= header->mappingSize) return ptr;
+#ifdef MREMAP_MAYMOVE
+        // let the kernel move the pages instead of copying them
+        size_t length = (newSize + ARRAY_CACHE_LINE + ARRAY_HUGE_PAGE_SIZE - 1) / ARRAY_HUGE_PAGE_SIZE * ARRAY_HUGE_PAGE_SIZE;
+        void *mapping = mremap(header->mapping, header->mappingSize, length, MREMAP_MAYMOVE);
+        if (mapping != MAP_FAILED) {
+            header = mapping;
+            header->mapping = mapping;
+            header->mappingSize = length;
+            return (char *) mapping + ARRAY_CACHE_LINE;
+        }
+#endif
+    }
+    void *data = array_aligned_alloc(context, newSize);
+    if (data == NULL) return NULL;
+    memcpy(data, ptr, oldSize < newSize ? oldSize : newSize);
+    array_aligned_free(context, ptr, oldSize);
+    return data;
+}
+
+void array_aligned_allocator_create(struct array_aligned_allocator *self, size_t hugePageThreshold) {
+    self->allocator.alloc = array_aligned_alloc;
+    self->allocator.realloc = array_aligned_realloc;
+    self->allocator.free = array_aligned_free;
+    self->allocator.context = self;
+    self->hugePageThreshold = hugePageThreshold;
+}
+
+const struct array_allocator *array_aligned_allocator(struct array_aligned_allocator *self) {
+    return &self->allocator;
+}
+
+/*
+ * file-backed arrays
+ *
+ * The file holds a 64-byte header followed by the elements, so that the elements are aligned in memory.
+ * The file is as long as the capacity of the array while it is open, and is cut down to its size when closed.
+ */
+
+#define ARRAY_FILE_MAGIC "BIBLIARR"
+#define ARRAY_FILE_VERSION 1
+#define ARRAY_FILE_HEADER_SIZE 64
+#define ARRAY_FILE_INITIAL_CAPACITY 1024
+
+struct array_file_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t elementSize;
+    uint64_t size;
+};
+
+struct array_mapping {
+    int fd;
+    char *base;
+    size_t length;
+    bool writable;
+};
+
+size_t array_file_length(size_t capacity) {
+    return ARRAY_FILE_HEADER_SIZE + capacity * sizeof(int);
+}
+
+/*
+ * Map length bytes of the file and point the array at the elements
+ */
+bool array_mapping_map(struct array *self, size_t length) {
+    struct array_mapping *mapping = self->mapping;
+    int protection = mapping->writable ? PROT_READ | PROT_WRITE : PROT_READ;
+    void *base = mmap(NULL, length, protection, MAP_SHARED, mapping->fd, 0);
+    if (base == MAP_FAILED) return false;
+    mapping->base = base;
+    mapping->length = length;
+    self->data = (int *) (mapping->base + ARRAY_FILE_HEADER_SIZE);
+    self->capacity = (length - ARRAY_FILE_HEADER_SIZE) / sizeof(int);
+    return true;
+}
+
+bool array_mapping_attach(struct array *self, int fd, bool writable, size_t length) {
+    // the elements live in the file, only the descriptor comes from the allocator
+    self->allocator = array_default_allocator;
+    self->mapping = self->allocator->alloc(self->allocator->context, sizeof(struct array_mapping));
+    if (self->mapping == NULL) return false;
+    self->mapping->fd = fd;
+    self->mapping->writable = writable;
+    if (!array_mapping_map(self, length)) {
+        self->allocator->free(self->allocator->context, self->mapping, sizeof(struct array_mapping));
+        self->mapping = NULL;
+        return false;
+    }
+    return true;
+}
+
+/*
+ * Resize the file and its mapping, keeping the old mapping until the new one is in place.
+ * The file grows before the mapping and shrinks after it, so the mapping never extends past its end.
+ */
+bool array_mapping_resize(struct array *self, size_t capacity) {
+    struct array_mapping *mapping = self->mapping;
+    assert(mapping->writable);
+    if (capacity > (SIZE_MAX - ARRAY_FILE_HEADER_SIZE) / sizeof(int)) return false;
+    size_t length = array_file_length(capacity);
+    // the file length must also be representable as an off_t
+    if ((off_t) length < 0 || (size_t) (off_t) length != length) return false;
+    if (length > mapping->length && ftruncate(mapping->fd, (off_t) length) != 0) return false;
+    void *base = MAP_FAILED;
+#ifdef MREMAP_MAYMOVE
+    base = mremap(mapping->base, mapping->length, length, MREMAP_MAYMOVE);
+#endif
+    if (base == MAP_FAILED) {
+        base = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, mapping->fd, 0);
+        if (base == MAP_FAILED) {
+            if (length > mapping->length) (void) ftruncate(mapping->fd, (off_t) mapping->length);
+            return false;
+        }
+        munmap(mapping->base, mapping->length);
+    }
+    // if this fails the file keeps its spare capacity, which does not make it invalid
+    if (length < mapping->length) (void) ftruncate(mapping->fd, (off_t) length);
+    mapping->base = base;
+    mapping->length = length;
+    self->data = (int *) (mapping->base + ARRAY_FILE_HEADER_SIZE);
+    self->capacity = capacity;
+    return true;
+}
+
+void array_sync_mapped(struct array *self) {
+    struct array_mapping *mapping = self->mapping;
+    if (mapping == NULL || !mapping->writable) return;
+    ((struct array_file_header *) mapping->base)->size = self->size;
+    msync(mapping->base, array_file_length(self->size), MS_SYNC);
 }
 
-void array_create_from(struct array *self, const int *other, size_t size) {
-    self->size = size;
-    self->capacity = size;
-    self->data = calloc(self->capacity, sizeof(int));
-    for (size_t i = 0; i < size; i++) self->data[i] = other[i];
+void array_mapping_close(struct array *self) {
+    struct array_mapping *mapping = self->mapping;
+    if (mapping->writable) ((struct array_file_header *) mapping->base)->size = self->size;
+    munmap(mapping->base, mapping->length);
+    // if this fails the file keeps its spare capacity, which does not make it invalid
+    if (mapping->writable) (void) ftruncate(mapping->fd, (off_t) array_file_length(self->size));
+    close(mapping->fd);
+    self->allocator->free(self->allocator->context, mapping, sizeof(struct array_mapping));
+    self->mapping = NULL;
+}
+
+bool array_create_mapped(struct array *self, const char *path) {
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    size_t length = array_file_length(ARRAY_FILE_INITIAL_CAPACITY);
+    if (ftruncate(fd, (off_t) length) != 0 || !array_mapping_attach(self, fd, true, length)) {
+        close(fd);
+        return false;
+    }
+    struct array_file_header *header = (struct array_file_header *) self->mapping->base;
+    memcpy(header->magic, ARRAY_FILE_MAGIC, sizeof(header->magic));
+    header->version = ARRAY_FILE_VERSION;
+    header->elementSize = sizeof(int);
+    header->size = 0;
+    self->size = 0;
+    return true;
+}
+
+bool array_open_mapped(struct array *self, const char *path, bool writable) {
+    int fd = open(path, writable ? O_RDWR : O_RDONLY);
+    if (fd < 0) return false;
+    struct stat info;
+    struct array_file_header header;
+    if (fstat(fd, &info) != 0
+            || (size_t) info.st_size < ARRAY_FILE_HEADER_SIZE
+            || pread(fd, &header, sizeof(header), 0) != (ssize_t) sizeof(header)
+            || memcmp(header.magic, ARRAY_FILE_MAGIC, sizeof(header.magic)) != 0
+            || header.version != ARRAY_FILE_VERSION
+            || header.elementSize != sizeof(int)
+            || header.size > ((size_t) info.st_size - ARRAY_FILE_HEADER_SIZE) / sizeof(int)
+            || !array_mapping_attach(self, fd, writable, (size_t) info.st_size)) {
+        close(fd);
+        return false;
+    }
+    self->size = (size_t) header.size;
+    return true;
+}
+
+double array_growth_factor = 2.0;
+
+void array_set_growth_factor(double factor) {
+    assert(factor > 1.0);
+    array_growth_factor = factor;
+}
+
+void array_create(struct array *self) {
+    array_create_with_capacity(self, ARRAY_INLINE_CAPACITY);
+}
+
+void array_create_with_capacity(struct array *self, size_t capacity) {
+    array_create_with_allocator(self, capacity, NULL);
+}
+
+void array_create_with_allocator(struct array *self, size_t capacity, const struct array_allocator *allocator) {
+    self->allocator = allocator == NULL ? array_default_allocator : allocator;
+    self->mapping = NULL;
+    self->size = 0;
+    self->capacity = ARRAY_INLINE_CAPACITY;
+    self->data = self->inline_data;
+    if (capacity > ARRAY_INLINE_CAPACITY && !array_set_capacity(self, capacity)) array_capacity_failure(capacity);
+}
+
+void array_create_from(struct array *self, const int *other, size_t size) {
+    array_create_with_capacity(self, size);
+    if (size > 0) memcpy(self->data, other, size * sizeof(int));
+    self->size = size;
+}
+
+void array_destroy(struct array *self) {
+    if (self->mapping != NULL) array_mapping_close(self);
+    else if (!array_is_inline(self)) self->allocator->free(self->allocator->context, self->data, self->capacity * sizeof(int));
+}
+
+bool array_empty(const struct array *self) {
+    return self->size == 0;
+}
+
+size_t array_size(const struct array *self) {
+    return self->size;
+}
+
+bool array_equals(const struct array *self, const int *content, size_t size) {
+    if (array_size(self) != size) return false;
+    return array_kernels()->equals(self->data, content, size);
+}
+
+bool array_is_inline(const struct array *self) {
+    return self->data == self->inline_data;
+}
+
+/*
+ * Change the capacity of the array, moving the elements between the inline buffer and the heap as needed.
+ * The capacity must not be less than the size. Tell if it succeeded: on failure the array is left unchanged.
+ */
+bool array_set_capacity(struct array *self, size_t capacity) {
+    if (capacity > SIZE_MAX / sizeof(int)) return false;
+    if (self->mapping != NULL) return array_mapping_resize(self, capacity);
+    if (capacity <= ARRAY_INLINE_CAPACITY) {
+        if (!array_is_inline(self)) {
+            if (self->size > 0) memcpy(self->inline_data, self->data, self->size * sizeof(int));
+            self->allocator->free(self->allocator->context, self->data, self->capacity * sizeof(int));
+            self->data = self->inline_data;
+        }
+        self->capacity = ARRAY_INLINE_CAPACITY;
+        return true;
+    }
+    int *data;
+    if (array_is_inline(self)) {
+        data = self->allocator->alloc(self->allocator->context, capacity * sizeof(int));
+        if (data == NULL) return false;
+        if (self->size > 0) memcpy(data, self->inline_data, self->size * sizeof(int));
+    }
+    else {
+        data = self->allocator->realloc(self->allocator->context, self->data,
+                self->capacity * sizeof(int), capacity * sizeof(int));
+        if (data == NULL) return false;
+    }
+    self->data = data;
+    self->capacity = capacity;
+    return true;
+}
+
+bool array_grow(struct array *self, size_t minCapacity) {
+    if (minCapacity <= self->capacity) return true;
+    double grown = (double) self->capacity * array_growth_factor;
+    // converting a double beyond the range of size_t is undefined
+    size_t capacity = grown < (double) (SIZE_MAX / sizeof(int)) ? (size_t) grown : SIZE_MAX / sizeof(int);
+    if (capacity <= self->capacity) capacity = self->capacity + 1;
+    if (capacity < minCapacity) capacity = minCapacity;
+    // a mapped file may not have room for the geometric growth, but still for what is needed
+    return array_set_capacity(self, capacity) || array_set_capacity(self, minCapacity);
+}
+
+/*
+ * Stop the program when an array that has no way to report a failure cannot get the capacity it needs
+ */
+void array_capacity_failure(size_t capacity) {
+    fprintf(stderr, "array: cannot allocate room for %zu elements\n", capacity);
+    abort();
+}
+
+void array_grow_or_abort(struct array *self, size_t minCapacity) {
+    if (!array_grow(self, minCapacity)) array_capacity_failure(minCapacity);
+}
+
+void array_increase_capacity(struct array *self) {
+    array_grow_or_abort(self, self->capacity + 1);
+}
+
+bool array_reserve(struct array *self, size_t capacity) {
+    return capacity <= self->capacity || array_set_capacity(self, capacity);
+}
+
+void array_shrink_to_fit(struct array *self) {
+    // keeping the capacity on failure is harmless
+    if (self->size < self->capacity) (void) array_set_capacity(self, self->size);
+}
+
+size_t array_capacity(const struct array *self) {
+    return self->capacity;
+}
+
+void array_push_back(struct array *self, int value) {
+    if (self->size >= self->capacity) array_increase_capacity(self);
+    self->data[self->size] = value;
+    self->size++;
+}
+
+void array_push_back_n(struct array *self, const int *values, size_t n) {
+    if (n == 0) return;
+    if (self->size + n > self->capacity) {
+        // values may point inside the array itself, which is about to move
+        bool inside = self->data != NULL && values >= self->data && values < self->data + self->size;
+        size_t offset = inside ? (size_t) (values - self->data) : 0;
+        array_grow_or_abort(self, self->size + n);
+        if (inside) values = self->data + offset;
+    }
+    memcpy(self->data + self->size, values, n * sizeof(int));
+    self->size += n;
+}
+
+void array_append_array(struct array *self, const struct array *other) {
+    array_push_back_n(self, other->data, other->size);
+}
+
+void array_assign(struct array *self, const int *values, size_t n) {
+    if (n > self->capacity) {
+        // the old content is dropped, so there is no need to copy it while growing
+        self->size = 0;
+        if (self->mapping == NULL) {
+            if (!array_is_inline(self)) self->allocator->free(self->allocator->context, self->data, self->capacity * sizeof(int));
+            self->data = self->inline_data;
+            self->capacity = ARRAY_INLINE_CAPACITY;
+        }
+        array_grow_or_abort(self, n);
+    }
+    if (n > 0) memmove(self->data, values, n * sizeof(int));
+    self->size = n;
+}
+
+void array_pop_back(struct array *self) {
+    assert(self->size > 0);
+    self->size--;
+}
+
+void array_insert(struct array *self, int value, size_t index) {
+    if (self->size == self->capacity) array_increase_capacity(self);
+    memmove(self->data + index + 1, self->data + index, (self->size - index) * sizeof(int));
+    self->data[index] = value;
+    self->size++;
+}
+
+void array_insert_range(struct array *self, const int *values, size_t n, size_t index) {
+    assert(index <= self->size);
+    if (n == 0) return;
+    int *copy = NULL;
+    if (self->data != NULL && values >= self->data && values < self->data + self->size) {
+        // values point inside the array, which is about to move
+        copy = self->allocator->alloc(self->allocator->context, n * sizeof(int));
+        if (copy == NULL) array_capacity_failure(n);
+        memcpy(copy, values, n * sizeof(int));
+        values = copy;
+    }
+    array_grow_or_abort(self, self->size + n);
+    memmove(self->data + index + n, self->data + index, (self->size - index) * sizeof(int));
+    memcpy(self->data + index, values, n * sizeof(int));
+    self->size += n;
+    if (copy != NULL) self->allocator->free(self->allocator->context, copy, n * sizeof(int));
+}
+
+void array_remove(struct array *self, size_t index) {
+    memmove(self->data + index, self->data + index + 1, (self->size - index - 1) * sizeof(int));
+    self->size--;
+}
+
+void array_remove_range(struct array *self, size_t index, size_t n) {
+    assert(index + n <= self->size);
+    if (n == 0) return;
+    memmove(self->data + index, self->data + index + n, (self->size - index - n) * sizeof(int));
+    self->size -= n;
+}
+
+size_t array_remove_if(struct array *self, array_predicate_t pred, void *user_data) {
+    size_t kept = 0;
+    for (size_t i = 0; i < self->size; i++) {
+        int value = self->data[i];
+        self->data[kept] = value;
+        kept += !pred(value, user_data);
+    }
+    size_t removed = self->size - kept;
+    self->size = kept;
+    return removed;
+}
+
+size_t array_retain(struct array *self, array_predicate_t pred, void *user_data) {
+    size_t kept = 0;
+    for (size_t i = 0; i < self->size; i++) {
+        int value = self->data[i];
+        self->data[kept] = value;
+        kept += pred(value, user_data);
+    }
+    size_t removed = self->size - kept;
+    self->size = kept;
+    return removed;
+}
+
+int array_get(const struct array *self, size_t index) {
+    return index >= self->size ? 0 : self->data[index];
+}
+
+void array_set(struct array *self, size_t index, int value) {
+    if (index >= self->size) return;
+    self->data[index] = value;
+}
+
+size_t array_search(const struct array *self, int value) {
+    return array_kernels()->find(self->data, self->size, value);
+}
+
+size_t array_count(const struct array *self, int value) {
+    return array_kernels()->count(self->data, self->size, value);
+}
+
+size_t array_search_all(const struct array *self, int value, size_t *indices, size_t max) {
+    const struct array_kernels *kernels = array_kernels();
+    size_t found = 0;
+    size_t i = kernels->find(self->data, self->size, value);
+    while (i < self->size) {
+        if (found < max) indices[found] = i;
+        found++;
+        i++;
+        i += kernels->find(self->data + i, self->size - i, value);
+    }
+    return found;
+}
+
+size_t array_lower_bound_in(const int *data, size_t size, int value) {
+    if (size == 0) return 0;
+    const int *base = data;
+    size_t n = size;
+    while (n > 1) {
+        size_t half = n / 2;
+        ARRAY_PREFETCH(base + (n - half) / 2);
+        ARRAY_PREFETCH(base + half + (n - half) / 2);
+        base = (base[half] < value) ? base + half : base;
+        n -= half;
+    }
+    return (size_t) (base - data) + (*base < value);
+}
+
+size_t array_upper_bound_in(const int *data, size_t size, int value) {
+    if (size == 0) return 0;
+    const int *base = data;
+    size_t n = size;
+    while (n > 1) {
+        size_t half = n / 2;
+        ARRAY_PREFETCH(base + (n - half) / 2);
+        ARRAY_PREFETCH(base + half + (n - half) / 2);
+        base = (base[half] <= value) ? base + half : base;
+        n -= half;
+    }
+    return (size_t) (base - data) + (*base <= value);
+}
+
+size_t array_lower_bound(const struct array *self, int value) {
+    return array_lower_bound_in(self->data, self->size, value);
+}
+
+size_t array_upper_bound(const struct array *self, int value) {
+    return array_upper_bound_in(self->data, self->size, value);
+}
+
+void array_equal_range(const struct array *self, int value, size_t *first, size_t *last) {
+    *first = array_lower_bound(self, value);
+    *last = *first + array_upper_bound_in(self->data + *first, self->size - *first, value);
+}
+
+size_t array_search_sorted(const struct array *self, int value) {
+    size_t index = array_lower_bound(self, value);
+    if (index < self->size && self->data[index] == value) return index;
+    return self->size;
+}
+
+#define ARRAY_BATCH_WIDTH 16
+
+void array_search_sorted_batch(const struct array *self, const int *keys, size_t n, size_t *out) {
+    const int *data = self->data;
+    size_t size = self->size;
+    if (size == 0) {
+        for (size_t i = 0; i < n; i++) out[i] = 0;
+        return;
+    }
+    for (size_t start = 0; start < n; start += ARRAY_BATCH_WIDTH) {
+        // run up to ARRAY_BATCH_WIDTH searches in lockstep so that their cache misses overlap
+        size_t count = n - start < ARRAY_BATCH_WIDTH ? n - start : ARRAY_BATCH_WIDTH;
+        const int *group = keys + start;
+        const int *bases[ARRAY_BATCH_WIDTH];
+        for (size_t j = 0; j < count; j++) bases[j] = data;
+        size_t remaining = size;
+        while (remaining > 1) {
+            size_t half = remaining / 2;
+            size_t next = (remaining - half) / 2;
+            for (size_t j = 0; j < count; j++) {
+                bases[j] = (bases[j][half] < group[j]) ? bases[j] + half : bases[j];
+                ARRAY_PREFETCH(bases[j] + next);
+            }
+            remaining -= half;
+        }
+        for (size_t j = 0; j < count; j++) {
+            size_t index = (size_t) (bases[j] - data) + (*bases[j] < group[j]);
+            out[start + j] = (index < size && data[index] == group[j]) ? index : size;
+        }
+    }
+}
+
+bool array_is_sorted(const struct array *self) {
+    return array_kernels()->is_sorted(self->data, self->size);
+}
+
+void array_swap(struct array *self, size_t firstIndex, size_t secondIndex) {
+    if (firstIndex >= self->size || secondIndex >= self->size) return;
+    int temp = self->data[firstIndex];
+    self->data[firstIndex] = self->data[secondIndex];
+    self->data[secondIndex] = temp;
+}
+
+ptrdiff_t array_partition(struct array *self, ptrdiff_t i, ptrdiff_t j) {
+    ptrdiff_t pivotIndex = i;
+    const int pivot = self->data[i];
+    array_swap(self, pivotIndex, j);
+    ptrdiff_t l = i;
+    for (ptrdiff_t k = i; k < j; k++) {
+        if (self->data[k] < pivot) {
+            array_swap(self, k, l);
+            l++;
+        }
+    }
+    array_swap(self, l, j);
+    return l;
+}
+
+void array_sort_small(struct array *self) {
+    assert(self->size <= ARRAY_SORT_SMALL_MAX);
+    array_kernels()->sort_small(self->data, self->size);
+}
+
+/*
+ * pattern-defeating quick sort on raw ranges [begin, end)
+ */
+
+#define ARRAY_SORT_INSERTION_THRESHOLD 24
+#define ARRAY_SORT_NINTHER_THRESHOLD 128
+#define ARRAY_SORT_PARTIAL_INSERTION_LIMIT 8
+
+void array_int_swap(int *a, int *b) {
+    int temp = *a;
+    *a = *b;
+    *b = temp;
+}
+
+void array_sort2(int *a, int *b) {
+    if (*b < *a) array_int_swap(a, b);
+}
+
+void array_sort3(int *a, int *b, int *c) {
+    array_sort2(a, b);
+    array_sort2(b, c);
+    array_sort2(a, b);
+}
+
+void array_insertion_sort(int *begin, int *end) {
+    if (begin == end) return;
+    for (int *cur = begin + 1; cur != end; cur++) {
+        int value = *cur;
+        int *sift = cur;
+        while (sift != begin && value < sift[-1]) {
+            *sift = sift[-1];
+            sift--;
+        }
+        *sift = value;
+    }
+}
+
+/*
+ * Insertion sort that relies on begin[-1] being not greater than any element of the range
+ */
+void array_unguarded_insertion_sort(int *begin, int *end) {
+    if (begin == end) return;
+    for (int *cur = begin + 1; cur != end; cur++) {
+        int value = *cur;
+        int *sift = cur;
+        while (value < sift[-1]) {
+            *sift = sift[-1];
+            sift--;
+        }
+        *sift = value;
+    }
+}
+
+/*
+ * Insertion sort that gives up once it has moved more than ARRAY_SORT_PARTIAL_INSERTION_LIMIT elements
+ * and tells if the range ended up sorted
+ */
+bool array_partial_insertion_sort(int *begin, int *end) {
+    if (begin == end) return true;
+    size_t moves = 0;
+    for (int *cur = begin + 1; cur != end; cur++) {
+        int value = *cur;
+        int *sift = cur;
+        while (sift != begin && value < sift[-1]) {
+            *sift = sift[-1];
+            sift--;
+        }
+        *sift = value;
+        moves += (size_t) (cur - sift);
+        if (moves > ARRAY_SORT_PARTIAL_INSERTION_LIMIT) return false;
+    }
+    return true;
+}
+
+void array_sift_down(int *data, size_t size, size_t index) {
+    int value = data[index];
+    while (2 * index + 1 < size) {
+        size_t child = 2 * index + 1;
+        if (child + 1 < size && data[child] < data[child + 1]) child++;
+        if (!(value < data[child])) break;
+        data[index] = data[child];
+        index = child;
+    }
+    data[index] = value;
+}
+
+/*
+ * Sift down without comparing the value at each level: walk down to a leaf along the larger children,
+ * then bounce back up to where the value belongs. The value usually comes from the bottom of the heap,
+ * so the climb is short and this takes about half the comparisons of array_sift_down.
+ */
+void array_sift_down_bottom_up(int *data, size_t size, size_t index) {
+    int value = data[index];
+    size_t start = index;
+    while (2 * index + 1 < size) {
+        size_t child = 2 * index + 1;
+        if (child + 1 < size && data[child] < data[child + 1]) child++;
+        data[index] = data[child];
+        index = child;
+    }
+    while (index > start) {
+        size_t parent = (index - 1) / 2;
+        if (!(data[parent] < value)) break;
+        data[index] = data[parent];
+        index = parent;
+    }
+    data[index] = value;
+}
+
+/*
+ * Floyd's construction: sift down every internal node from the last one, which is O(n) overall
+ */
+void array_heapify_range(int *data, size_t size) {
+    for (size_t i = size / 2; i > 0; i--) array_sift_down(data, size, i - 1);
+}
+
+void array_heap_sort_range(int *begin, int *end) {
+    size_t size = (size_t) (end - begin);
+    array_heapify_range(begin, size);
+    for (size_t i = size; i > 1; i--) {
+        array_int_swap(begin, begin + i - 1);
+        array_sift_down_bottom_up(begin, i - 1, 0);
+    }
+}
+
+/*
+ * Partition around *begin, putting the elements equal to the pivot on the right.
+ * Tell in alreadyPartitioned if no element had to be moved.
+ */
+int *array_partition_right(int *begin, int *end, bool *alreadyPartitioned) {
+    int pivot = *begin;
+    int *first = begin;
+    int *last = end;
+    while (*++first < pivot);
+    if (first - 1 == begin) {
+        while (first < last && !(*--last < pivot));
+    }
+    else {
+        while (!(*--last < pivot));
+    }
+    *alreadyPartitioned = first >= last;
+    while (first < last) {
+        array_int_swap(first, last);
+        while (*++first < pivot);
+        while (!(*--last < pivot));
+    }
+    int *pivotPos = first - 1;
+    *begin = *pivotPos;
+    *pivotPos = pivot;
+    return pivotPos;
+}
+
+/*
+ * Partition around *begin, putting the elements equal to the pivot on the left.
+ * Used when the pivot equals the element just before the range, so that runs of equal elements are skipped at once.
+ */
+int *array_partition_left(int *begin, int *end) {
+    int pivot = *begin;
+    int *first = begin;
+    int *last = end;
+    while (pivot < *--last);
+    if (last + 1 == end) {
+        while (first < last && !(pivot < *++first));
+    }
+    else {
+        while (!(pivot < *++first));
+    }
+    while (first < last) {
+        array_int_swap(first, last);
+        while (pivot < *--last);
+        while (!(pivot < *++first));
+    }
+    int *pivotPos = last;
+    *begin = *pivotPos;
+    *pivotPos = pivot;
+    return pivotPos;
+}
+
+/*
+ * Move a median of 3 (or a ninther for large ranges) to the beginning of the range, which must hold at least 3 elements
+ */
+void array_choose_pivot(int *begin, int *end) {
+    size_t size = (size_t) (end - begin);
+    size_t half = size / 2;
+    if (size > ARRAY_SORT_NINTHER_THRESHOLD) {
+        array_sort3(begin, begin + half, end - 1);
+        array_sort3(begin + 1, begin + (half - 1), end - 2);
+        array_sort3(begin + 2, begin + (half + 1), end - 3);
+        array_sort3(begin + (half - 1), begin + half, begin + (half + 1));
+        array_int_swap(begin, begin + half);
+    }
+    else {
+        array_sort3(begin + half, begin, end - 1);
+    }
+}
+
+void array_pdq_sort_loop(int *begin, int *end, int badAllowed, bool leftmost) {
+    const struct array_kernels *kernels = array_kernels();
+    while (true) {
+        size_t size = (size_t) (end - begin);
+        if (size <= kernels->sort_small_threshold) {
+            kernels->sort_small(begin, size);
+            return;
+        }
+        if (size < ARRAY_SORT_INSERTION_THRESHOLD) {
+            if (leftmost) array_insertion_sort(begin, end);
+            else array_unguarded_insertion_sort(begin, end);
+            return;
+        }
+
+        array_choose_pivot(begin, end);
+
+        if (!leftmost && !(begin[-1] < *begin)) {
+            begin = array_partition_left(begin, end) + 1;
+            continue;
+        }
+
+        bool alreadyPartitioned;
+        int *pivotPos = array_partition_right(begin, end, &alreadyPartitioned);
+        size_t leftSize = (size_t) (pivotPos - begin);
+        size_t rightSize = (size_t) (end - (pivotPos + 1));
+
+        if (leftSize < size / 8 || rightSize < size / 8) {
+            // bad pivot: fall back to heap sort after too many, otherwise shuffle some elements to break patterns
+            if (--badAllowed == 0) {
+                array_heap_sort_range(begin, end);
+                return;
+            }
+            if (leftSize >= ARRAY_SORT_INSERTION_THRESHOLD) {
+                array_int_swap(begin, begin + leftSize / 4);
+                array_int_swap(pivotPos - 1, pivotPos - leftSize / 4);
+                if (leftSize > ARRAY_SORT_NINTHER_THRESHOLD) {
+                    array_int_swap(begin + 1, begin + (leftSize / 4 + 1));
+                    array_int_swap(begin + 2, begin + (leftSize / 4 + 2));
+                    array_int_swap(pivotPos - 2, pivotPos - (leftSize / 4 + 1));
+                    array_int_swap(pivotPos - 3, pivotPos - (leftSize / 4 + 2));
+                }
+            }
+            if (rightSize >= ARRAY_SORT_INSERTION_THRESHOLD) {
+                array_int_swap(pivotPos + 1, pivotPos + (1 + rightSize / 4));
+                array_int_swap(end - 1, end - rightSize / 4);
+                if (rightSize > ARRAY_SORT_NINTHER_THRESHOLD) {
+                    array_int_swap(pivotPos + 2, pivotPos + (2 + rightSize / 4));
+                    array_int_swap(pivotPos + 3, pivotPos + (3 + rightSize / 4));
+                    array_int_swap(end - 2, end - (1 + rightSize / 4));
+                    array_int_swap(end - 3, end - (2 + rightSize / 4));
+                }
+            }
+        }
+        else if (alreadyPartitioned
+                && array_partial_insertion_sort(begin, pivotPos)
+                && array_partial_insertion_sort(pivotPos + 1, end)) {
+            return;
+        }
+
+        // recurse into the smaller side only to keep the stack depth logarithmic
+        if (leftSize < rightSize) {
+            array_pdq_sort_loop(begin, pivotPos, badAllowed, leftmost);
+            begin = pivotPos + 1;
+            leftmost = false;
+        }
+        else {
+            array_pdq_sort_loop(pivotPos + 1, end, badAllowed, false);
+            end = pivotPos;
+        }
+    }
+}
+
+void array_pdq_sort(int *begin, int *end) {
+    int badAllowed = 1;
+    for (size_t size = (size_t) (end - begin); size > 1; size /= 2) badAllowed++;
+    array_pdq_sort_loop(begin, end, badAllowed, true);
+}
+
+/*
+ * Move a median of medians of groups of 5 to the beginning of the range, which guarantees that at least
+ * 30% of the elements end up on each side of the partition
+ */
+void array_median_of_medians(int *begin, int *end) {
+    size_t groups = 0;
+    for (int *group = begin; group + 5 <= end; group += 5) {
+        array_insertion_sort(group, group + 5);
+        array_int_swap(begin + groups, group + 2);
+        groups++;
+    }
+    array_select_range(begin, begin + groups, begin + groups / 2, 0, true);
+    array_int_swap(begin, begin + groups / 2);
+}
+
+/*
+ * Introselect: quickselect with the pivots of the sort engine, switching to median of medians pivots
+ * once too many partitions were unbalanced
+ */
+void array_select_range(int *begin, int *end, int *nth, int badAllowed, bool leftmost) {
+    while (end - begin > ARRAY_SORT_INSERTION_THRESHOLD) {
+        size_t size = (size_t) (end - begin);
+        if (badAllowed > 0) array_choose_pivot(begin, end);
+        else array_median_of_medians(begin, end);
+
+        if (!leftmost && !(begin[-1] < *begin)) {
+            // everything up to the returned position equals the pivot
+            int *last = array_partition_left(begin, end);
+            if (nth <= last) return;
+            begin = last + 1;
+            continue;
+        }
+
+        bool alreadyPartitioned;
+        int *pivotPos = array_partition_right(begin, end, &alreadyPartitioned);
+        if (pivotPos == nth) return;
+        size_t leftSize = (size_t) (pivotPos - begin);
+        if (badAllowed > 0 && (leftSize < size / 8 || size - leftSize - 1 < size / 8)) badAllowed--;
+        if (nth < pivotPos) {
+            end = pivotPos;
+        }
+        else {
+            begin = pivotPos + 1;
+            leftmost = false;
+        }
+    }
+    array_insertion_sort(begin, end);
+}
+
+void array_quick_sort(struct array *self) {
+    if (self->size < 2) return;
+    array_pdq_sort(self->data, self->data + self->size);
+}
+
+void array_nth_element(struct array *self, size_t k) {
+    assert(k < self->size);
+    int badAllowed = 1;
+    for (size_t size = self->size; size > 1; size /= 2) badAllowed++;
+    array_select_range(self->data, self->data + self->size, self->data + k, badAllowed, true);
+}
+
+int array_select_kth(struct array *self, size_t k) {
+    array_nth_element(self, k);
+    return self->data[k];
+}
+
+void array_partial_sort(struct array *self, size_t k) {
+    if (k >= self->size) {
+        array_quick_sort(self);
+        return;
+    }
+    if (k == 0) return;
+    array_nth_element(self, k - 1);
+    array_pdq_sort(self->data, self->data + k - 1);
+}
+
+/*
+ * parallel quick sort
+ */
+
+#define ARRAY_PARALLEL_SORT_CUTOFF 16384
+#define ARRAY_PARALLEL_PARTITION_THRESHOLD (1 << 20)
+
+struct array_sort_task {
+    int *begin;
+    int *end;
+};
+
+struct array_sort_deque {
+    struct array_sort_task *tasks;
+    size_t head;
+    size_t tail;
+    size_t capacity;
+    pthread_mutex_t lock;
+};
+
+struct array_sort_pool {
+    struct array_sort_deque *deques;
+    unsigned threads;
+    // tasks pushed and not finished yet
+    size_t pending;
+    // tasks waiting in the deques, briefly off by the pushes and takes in progress
+    ptrdiff_t queued;
+    pthread_mutex_t lock;
+    // signaled when a task is queued or when the last task is finished
+    pthread_cond_t wake;
+};
+
+struct array_sort_worker {
+    struct array_sort_pool *pool;
+    unsigned id;
+};
+
+unsigned array_hardware_threads(void) {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count < 1 ? 1 : (unsigned) count;
+}
+
+void array_sort_pool_push(struct array_sort_pool *pool, unsigned id, int *begin, int *end) {
+    struct array_sort_deque *deque = &pool->deques[id];
+    pthread_mutex_lock(&deque->lock);
+    if (deque->tail == deque->capacity) {
+        size_t capacity = deque->capacity == 0 ? 16 : 2 * deque->capacity;
+        struct array_sort_task *tasks = realloc(deque->tasks, capacity * sizeof(struct array_sort_task));
+        if (tasks == NULL) {
+            // no room to queue the task: sort the range right away
+            pthread_mutex_unlock(&deque->lock);
+            array_pdq_sort(begin, end);
+            return;
+        }
+        deque->tasks = tasks;
+        deque->capacity = capacity;
+    }
+    // counted before it becomes visible, so that pending cannot reach 0 while it is queued
+    pthread_mutex_lock(&pool->lock);
+    pool->pending++;
+    pthread_mutex_unlock(&pool->lock);
+    deque->tasks[deque->tail].begin = begin;
+    deque->tasks[deque->tail].end = end;
+    deque->tail++;
+    pthread_mutex_unlock(&deque->lock);
+    pthread_mutex_lock(&pool->lock);
+    pool->queued++;
+    pthread_cond_signal(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/*
+ * Take the newest task of a worker's own deque, or steal the oldest task of another worker
+ */
+bool array_sort_pool_take(struct array_sort_pool *pool, unsigned id, struct array_sort_task *task) {
+    struct array_sort_deque *own = &pool->deques[id];
+    bool found = false;
+    pthread_mutex_lock(&own->lock);
+    if (own->head < own->tail) {
+        *task = own->tasks[--own->tail];
+        found = true;
+    }
+    if (own->head == own->tail) own->head = own->tail = 0;
+    pthread_mutex_unlock(&own->lock);
+    for (unsigned i = 1; !found && i < pool->threads; i++) {
+        struct array_sort_deque *victim = &pool->deques[(id + i) % pool->threads];
+        pthread_mutex_lock(&victim->lock);
+        if (victim->head < victim->tail) {
+            *task = victim->tasks[victim->head++];
+            found = true;
+        }
+        pthread_mutex_unlock(&victim->lock);
+    }
+    if (found) {
+        pthread_mutex_lock(&pool->lock);
+        pool->queued--;
+        pthread_mutex_unlock(&pool->lock);
+    }
+    return found;
+}
+
+void array_sort_pool_run(struct array_sort_pool *pool, unsigned id, int *begin, int *end) {
+    while ((size_t) (end - begin) > ARRAY_PARALLEL_SORT_CUTOFF) {
+        size_t size = (size_t) (end - begin);
+        array_choose_pivot(begin, end);
+        bool alreadyPartitioned;
+        int *pivotPos = array_partition_right(begin, end, &alreadyPartitioned);
+        size_t leftSize = (size_t) (pivotPos - begin);
+        size_t rightSize = (size_t) (end - (pivotPos + 1));
+        if (leftSize < size / 8 || rightSize < size / 8) break; // let the sequential sort deal with bad patterns
+        array_sort_pool_push(pool, id, pivotPos + 1, end);
+        end = pivotPos;
+    }
+    array_pdq_sort(begin, end);
+}
+
+void *array_sort_worker_main(void *argument) {
+    struct array_sort_worker *worker = argument;
+    struct array_sort_pool *pool = worker->pool;
+    while (true) {
+        struct array_sort_task task;
+        if (array_sort_pool_take(pool, worker->id, &task)) {
+            array_sort_pool_run(pool, worker->id, task.begin, task.end);
+            pthread_mutex_lock(&pool->lock);
+            if (--pool->pending == 0) pthread_cond_broadcast(&pool->wake);
+            pthread_mutex_unlock(&pool->lock);
+            continue;
+        }
+        // sleep until there is something to steal or everything is sorted
+        pthread_mutex_lock(&pool->lock);
+        while (pool->pending > 0 && pool->queued <= 0) pthread_cond_wait(&pool->wake, &pool->lock);
+        bool done = pool->pending == 0;
+        pthread_mutex_unlock(&pool->lock);
+        if (done) break;
+    }
+    return NULL;
+}
+
+/*
+ * Blocked parallel partition: every thread partitions its own block, then the elements that ended up
+ * on the wrong side of the global split are swapped pairwise, each thread taking an equal share.
+ */
+
+struct array_partition_job {
+    int *data;
+    int pivot;
+    unsigned threads;
+    size_t *blockBegin;
+    size_t *blockMiddle;
+    size_t split;
+    size_t misplaced;
+    unsigned id;
+};
+
+/*
+ * Move the elements of [first, last) less than pivot to the beginning and return where they end
+ */
+int *array_partition_less(int *first, int *last, int pivot) {
+    while (true) {
+        while (first < last && *first < pivot) first++;
+        while (first < last && !(last[-1] < pivot)) last--;
+        if (first >= last) break;
+        array_int_swap(first, last - 1);
+        first++;
+        last--;
+    }
+    return first;
+}
+
+void *array_partition_block_main(void *argument) {
+    struct array_partition_job *job = argument;
+    unsigned id = job->id;
+    int *middle = array_partition_less(job->data + job->blockBegin[id], job->data + job->blockBegin[id + 1], job->pivot);
+    job->blockMiddle[id] = (size_t) (middle - job->data);
+    return NULL;
+}
+
+/*
+ * Get the misplaced elements of a block: the large ones left of the split or the small ones right of it
+ */
+bool array_partition_misplaced(const struct array_partition_job *job, unsigned block, bool large, size_t *from, size_t *to) {
+    if (large) {
+        *from = job->blockMiddle[block];
+        *to = job->blockBegin[block + 1] < job->split ? job->blockBegin[block + 1] : job->split;
+    }
+    else {
+        *from = job->blockBegin[block] > job->split ? job->blockBegin[block] : job->split;
+        *to = job->blockMiddle[block];
+    }
+    return *from < *to;
+}
+
+struct array_partition_cursor {
+    unsigned block;
+    size_t position;
+    size_t to;
+};
+
+void array_partition_cursor_seek(const struct array_partition_job *job, struct array_partition_cursor *cursor, size_t k, bool large) {
+    for (cursor->block = 0; cursor->block < job->threads; cursor->block++) {
+        size_t from;
+        if (!array_partition_misplaced(job, cursor->block, large, &from, &cursor->to)) continue;
+        if (k < cursor->to - from) {
+            cursor->position = from + k;
+            return;
+        }
+        k -= cursor->to - from;
+    }
+}
+
+void array_partition_cursor_next(const struct array_partition_job *job, struct array_partition_cursor *cursor, bool large) {
+    if (++cursor->position < cursor->to) return;
+    while (++cursor->block < job->threads) {
+        if (array_partition_misplaced(job, cursor->block, large, &cursor->position, &cursor->to)) return;
+    }
+}
+
+void *array_partition_swap_main(void *argument) {
+    struct array_partition_job *job = argument;
+    size_t from = job->misplaced * job->id / job->threads;
+    size_t to = job->misplaced * (job->id + 1) / job->threads;
+    if (from == to) return NULL;
+    struct array_partition_cursor large, small;
+    array_partition_cursor_seek(job, &large, from, true);
+    array_partition_cursor_seek(job, &small, from, false);
+    for (size_t k = from; k < to; k++) {
+        array_int_swap(job->data + large.position, job->data + small.position);
+        array_partition_cursor_next(job, &large, true);
+        array_partition_cursor_next(job, &small, false);
+    }
+    return NULL;
+}
+
+/*
+ * Run phase on every job of an array of threads jobs of jobSize bytes each, one thread per job,
+ * the calling thread taking the first one and the jobs whose thread could not be created
+ */
+void array_run_parallel(void *jobs, size_t jobSize, unsigned threads, void *(*phase)(void *)) {
+    pthread_t *ids = malloc(threads * sizeof(pthread_t));
+    bool *started = malloc(threads * sizeof(bool));
+    for (unsigned i = 1; started != NULL && i < threads; i++) {
+        started[i] = ids != NULL && pthread_create(&ids[i], NULL, phase, (char *) jobs + i * jobSize) == 0;
+    }
+    phase(jobs);
+    for (unsigned i = 1; i < threads; i++) {
+        if (started != NULL && started[i]) pthread_join(ids[i], NULL);
+        else phase((char *) jobs + i * jobSize);
+    }
+    free(started);
+    free(ids);
+}
+
+/*
+ * Partition [begin, end) with several threads so that the elements less than pivot come first and return the split
+ */
+int *array_parallel_partition(int *begin, int *end, int pivot, unsigned threads) {
+    size_t size = (size_t) (end - begin);
+    size_t *blockBegin = malloc((threads + 1) * sizeof(size_t));
+    size_t *blockMiddle = malloc(threads * sizeof(size_t));
+    struct array_partition_job *jobs = malloc(threads * sizeof(struct array_partition_job));
+    if (blockBegin == NULL || blockMiddle == NULL || jobs == NULL) {
+        // not enough memory to split the work: partition on the calling thread
+        free(jobs);
+        free(blockMiddle);
+        free(blockBegin);
+        return array_partition_less(begin, end, pivot);
+    }
+    for (unsigned i = 0; i <= threads; i++) blockBegin[i] = size * i / threads;
+    for (unsigned i = 0; i < threads; i++) {
+        jobs[i].data = begin;
+        jobs[i].pivot = pivot;
+        jobs[i].threads = threads;
+        jobs[i].blockBegin = blockBegin;
+        jobs[i].blockMiddle = blockMiddle;
+        jobs[i].id = i;
+    }
+    array_run_parallel(jobs, sizeof(struct array_partition_job), threads, array_partition_block_main);
+
+    size_t split = 0;
+    for (unsigned i = 0; i < threads; i++) split += blockMiddle[i] - blockBegin[i];
+    size_t misplaced = 0;
+    for (unsigned i = 0; i < threads; i++) {
+        if (blockMiddle[i] > split) {
+            misplaced += blockMiddle[i] - (blockBegin[i] > split ? blockBegin[i] : split);
+        }
+    }
+    for (unsigned i = 0; i < threads; i++) {
+        jobs[i].split = split;
+        jobs[i].misplaced = misplaced;
+    }
+    array_run_parallel(jobs, sizeof(struct array_partition_job), threads, array_partition_swap_main);
+
+    free(jobs);
+    free(blockMiddle);
+    free(blockBegin);
+    return begin + split;
+}
+
+void array_quick_sort_parallel(struct array *self, unsigned threads) {
+    if (threads == 0) threads = array_hardware_threads();
+    if (threads == 1 || self->size <= ARRAY_PARALLEL_SORT_CUTOFF) {
+        array_quick_sort(self);
+        return;
+    }
+
+    struct array_sort_pool pool;
+    pool.threads = threads;
+    pool.pending = 0;
+    pool.queued = 0;
+    pool.deques = calloc(threads, sizeof(struct array_sort_deque));
+    struct array_sort_worker *workers = malloc(threads * sizeof(struct array_sort_worker));
+    pthread_t *ids = malloc(threads * sizeof(pthread_t));
+    if (pool.deques == NULL || workers == NULL || ids == NULL) {
+        free(ids);
+        free(workers);
+        free(pool.deques);
+        array_quick_sort(self);
+        return;
+    }
+    pthread_mutex_init(&pool.lock, NULL);
+    pthread_cond_init(&pool.wake, NULL);
+    for (unsigned i = 0; i < threads; i++) pthread_mutex_init(&pool.deques[i].lock, NULL);
+
+    int *begin = self->data;
+    int *end = self->data + self->size;
+    if (self->size >= ARRAY_PARALLEL_PARTITION_THRESHOLD) {
+        array_choose_pivot(begin, end);
+        int *split = array_parallel_partition(begin, end, *begin, threads);
+        array_sort_pool_push(&pool, 0, begin, split);
+        array_sort_pool_push(&pool, threads > 1 ? 1 : 0, split, end);
+    }
+    else {
+        array_sort_pool_push(&pool, 0, begin, end);
+    }
+
+    for (unsigned i = 0; i < threads; i++) {
+        workers[i].pool = &pool;
+        workers[i].id = i;
+    }
+    // the tasks of a worker whose thread could not be created are stolen by the others
+    unsigned started = 1;
+    while (started < threads && pthread_create(&ids[started], NULL, array_sort_worker_main, &workers[started]) == 0) started++;
+    array_sort_worker_main(&workers[0]);
+    for (unsigned i = 1; i < started; i++) pthread_join(ids[i], NULL);
+
+    for (unsigned i = 0; i < threads; i++) {
+        pthread_mutex_destroy(&pool.deques[i].lock);
+        free(pool.deques[i].tasks);
+    }
+    free(pool.deques);
+    pthread_cond_destroy(&pool.wake);
+    pthread_mutex_destroy(&pool.lock);
+    free(ids);
+    free(workers);
+}
+
+/*
+ * parallel sample sort
+ */
+
+#define ARRAY_SAMPLE_SORT_THRESHOLD 65536
+#define ARRAY_SAMPLE_OVERSAMPLING 64
+#define ARRAY_SAMPLE_BUCKETS_PER_THREAD 4
+#define ARRAY_SCATTER_BUFFER 16
+
+struct array_sample_sort {
+    int *data;
+    int *scratch;
+    size_t size;
+    unsigned threads;
+    int *splitters;
+    size_t splitterCount;
+    size_t buckets;
+    size_t *counts; // threads rows of buckets counters, turned into write offsets
+    int (*buffers)[ARRAY_SCATTER_BUFFER]; // threads rows of buckets scatter buffers
+    unsigned char *fill;
+    size_t nextBucket;
+    pthread_mutex_t lock;
+};
+
+struct array_sample_job {
+    struct array_sample_sort *sort;
+    unsigned id;
+};
+
+/*
+ * Bucket of a value: the values between splitters i - 1 and i go to bucket 2i, and the values equal
+ * to splitter i to bucket 2i + 1, so that heavily duplicated keys fill buckets that need no sorting
+ * instead of overloading a single one
+ */
+size_t array_sample_bucket(const struct array_sample_sort *sort, int value) {
+    size_t above = array_upper_bound_in(sort->splitters, sort->splitterCount, value);
+    if (above > 0 && sort->splitters[above - 1] == value) return 2 * above - 1;
+    return 2 * above;
 }
 
-void array_destroy(struct array *self) {
-    free(self->data);
+void *array_sample_count_main(void *argument) {
+    struct array_sample_job *job = argument;
+    struct array_sample_sort *sort = job->sort;
+    size_t from = sort->size * job->id / sort->threads;
+    size_t to = sort->size * (job->id + 1) / sort->threads;
+    size_t *counts = sort->counts + job->id * sort->buckets;
+    for (size_t i = from; i < to; i++) counts[array_sample_bucket(sort, sort->data[i])]++;
+    return NULL;
 }
 
-bool array_empty(const struct array *self) {
-    return self->size == 0;
+/*
+ * Scatter through one cache line of buffer per bucket, so that the writes to the scratch buffer
+ * go out a full line at a time instead of touching a different line for nearly every element
+ */
+void *array_sample_scatter_main(void *argument) {
+    struct array_sample_job *job = argument;
+    struct array_sample_sort *sort = job->sort;
+    size_t from = sort->size * job->id / sort->threads;
+    size_t to = sort->size * (job->id + 1) / sort->threads;
+    size_t *offsets = sort->counts + job->id * sort->buckets;
+    int (*buffers)[ARRAY_SCATTER_BUFFER] = sort->buffers + job->id * sort->buckets;
+    unsigned char *fill = sort->fill + job->id * sort->buckets;
+    for (size_t i = from; i < to; i++) {
+        int value = sort->data[i];
+        size_t bucket = array_sample_bucket(sort, value);
+        buffers[bucket][fill[bucket]++] = value;
+        if (fill[bucket] == ARRAY_SCATTER_BUFFER) {
+            memcpy(sort->scratch + offsets[bucket], buffers[bucket], sizeof(buffers[bucket]));
+            offsets[bucket] += ARRAY_SCATTER_BUFFER;
+            fill[bucket] = 0;
+        }
+    }
+    for (size_t bucket = 0; bucket < sort->buckets; bucket++) {
+        memcpy(sort->scratch + offsets[bucket], buffers[bucket], fill[bucket] * sizeof(int));
+        offsets[bucket] += fill[bucket];
+    }
+    return NULL;
 }
 
-size_t array_size(const struct array *self) {
-    return self->size;
+/*
+ * Take buckets one at a time until none is left, sort them and copy them back in place
+ */
+void *array_sample_sort_main(void *argument) {
+    struct array_sample_job *job = argument;
+    struct array_sample_sort *sort = job->sort;
+    while (true) {
+        pthread_mutex_lock(&sort->lock);
+        size_t bucket = sort->nextBucket++;
+        pthread_mutex_unlock(&sort->lock);
+        if (bucket >= sort->buckets) break;
+        // after the scatter, the offsets of the last thread mark the end of every bucket
+        size_t end = sort->counts[(sort->threads - 1) * sort->buckets + bucket];
+        size_t begin = bucket == 0 ? 0 : sort->counts[(sort->threads - 1) * sort->buckets + bucket - 1];
+        if (bucket % 2 == 0) array_pdq_sort(sort->scratch + begin, sort->scratch + end);
+        memcpy(sort->data + begin, sort->scratch + begin, (end - begin) * sizeof(int));
+    }
+    return NULL;
 }
 
-bool array_equals(const struct array *self, const int *content, size_t size) {
-    if (array_size(self) != size) return false;
-    for (size_t i = 0; i < size; i++) if (self->data[i] != content[i]) return false;
-    return true;
-}
+void array_sort_parallel(struct array *self, unsigned threads) {
+    if (threads == 0) threads = array_hardware_threads();
+    if (threads == 1 || self->size < ARRAY_SAMPLE_SORT_THRESHOLD) {
+        array_quick_sort(self);
+        return;
+    }
 
-void array_increase_capacity(struct array *self) {
-    self->capacity *= A;
-    int *data = calloc(self->capacity, sizeof(int));
-    for (size_t i = 0; i < self->size; i++) data[i] = self->data[i];
-    free(self->data);
-    self->data = data;
+    struct array_sample_sort sort;
+    sort.data = self->data;
+    sort.size = self->size;
+    sort.threads = threads;
+    sort.splitterCount = (size_t) threads * ARRAY_SAMPLE_BUCKETS_PER_THREAD - 1;
+    sort.buckets = 2 * sort.splitterCount + 1;
+    sort.nextBucket = 0;
+    size_t samples = (sort.splitterCount + 1) * ARRAY_SAMPLE_OVERSAMPLING;
+    int *sample = malloc(samples * sizeof(int));
+    sort.splitters = malloc(sort.splitterCount * sizeof(int));
+    sort.scratch = malloc(sort.size * sizeof(int));
+    sort.counts = calloc((size_t) threads * sort.buckets, sizeof(size_t));
+    sort.buffers = malloc((size_t) threads * sort.buckets * sizeof(*sort.buffers));
+    sort.fill = calloc((size_t) threads * sort.buckets, 1);
+    struct array_sample_job *jobs = malloc(threads * sizeof(struct array_sample_job));
+    if (sample == NULL || sort.splitters == NULL || sort.scratch == NULL || sort.counts == NULL
+            || sort.buffers == NULL || sort.fill == NULL || jobs == NULL) {
+        // not enough memory for a copy of the array: sort it in place
+        free(sample);
+        free(sort.splitters);
+        free(sort.scratch);
+        free(sort.counts);
+        free(sort.buffers);
+        free(sort.fill);
+        free(jobs);
+        array_quick_sort(self);
+        return;
+    }
+    pthread_mutex_init(&sort.lock, NULL);
+
+    // evenly spaced samples, sorted, give the splitters between buckets
+    for (size_t i = 0; i < samples; i++) sample[i] = sort.data[(i * sort.size + sort.size / 2) / samples];
+    array_pdq_sort(sample, sample + samples);
+    for (size_t i = 0; i < sort.splitterCount; i++) sort.splitters[i] = sample[(i + 1) * ARRAY_SAMPLE_OVERSAMPLING];
+    free(sample);
+
+    for (unsigned i = 0; i < threads; i++) {
+        jobs[i].sort = &sort;
+        jobs[i].id = i;
+    }
+
+    array_run_parallel(jobs, sizeof(struct array_sample_job), threads, array_sample_count_main);
+    size_t offset = 0;
+    for (size_t bucket = 0; bucket < sort.buckets; bucket++) {
+        for (unsigned thread = 0; thread < threads; thread++) {
+            size_t count = sort.counts[thread * sort.buckets + bucket];
+            sort.counts[thread * sort.buckets + bucket] = offset;
+            offset += count;
+        }
+    }
+    array_run_parallel(jobs, sizeof(struct array_sample_job), threads, array_sample_scatter_main);
+    array_run_parallel(jobs, sizeof(struct array_sample_job), threads, array_sample_sort_main);
+
+    free(jobs);
+    free(sort.fill);
+    free(sort.buffers);
+    free(sort.counts);
+    free(sort.scratch);
+    free(sort.splitters);
+    pthread_mutex_destroy(&sort.lock);
 }
 
-void array_push_back(struct array *self, int value) {
-    if (self->size >= self->capacity) array_increase_capacity(self);
-    self->data[self->size] = value;
-    self->size++;
+/*
+ * stable sort
+ *
+ * TimSort: split the array into natural runs, extend the short ones to a minimum length with a
+ * binary insertion sort, and merge them so that the run lengths on the stack stay balanced.
+ * Merges copy the shorter run aside and switch to galloping when one run keeps winning.
+ */
+
+#define ARRAY_STABLE_SORT_MIN_GALLOP 7
+#define ARRAY_STABLE_SORT_MAX_RUNS 85
+
+struct array_stable_sort {
+    int *buffer;
+    size_t minGallop;
+    size_t runCount;
+    int *runBase[ARRAY_STABLE_SORT_MAX_RUNS];
+    size_t runLength[ARRAY_STABLE_SORT_MAX_RUNS];
+};
+
+/*
+ * Scratch buffer kept between calls, one per thread, freed when the thread exits
+ */
+struct array_stable_sort_buffer {
+    int *data;
+    size_t size;
+};
+
+pthread_key_t array_stable_sort_key;
+pthread_once_t array_stable_sort_key_once = PTHREAD_ONCE_INIT;
+
+void array_stable_sort_buffer_free(void *argument) {
+    struct array_stable_sort_buffer *buffer = argument;
+    free(buffer->data);
+    free(buffer);
 }
 
-void array_pop_back(struct array *self) {
-    assert(self->size > 0);
-    self->size--;
+void array_stable_sort_key_init(void) {
+    pthread_key_create(&array_stable_sort_key, array_stable_sort_buffer_free);
 }
 
-void array_insert(struct array *self, int value, size_t index) {
-    if (self->size == self->capacity) array_increase_capacity(self);
-    for (size_t i = self->size; i > index; i--) {
-        self->data[i] = self->data[i - 1];
+/*
+ * Get the buffer of the calling thread with room for at least size elements, or NULL
+ */
+int *array_stable_sort_get_buffer(size_t size) {
+    pthread_once(&array_stable_sort_key_once, array_stable_sort_key_init);
+    struct array_stable_sort_buffer *buffer = pthread_getspecific(array_stable_sort_key);
+    if (buffer == NULL) {
+        buffer = calloc(1, sizeof(struct array_stable_sort_buffer));
+        if (buffer == NULL) return NULL;
+        if (pthread_setspecific(array_stable_sort_key, buffer) != 0) {
+            free(buffer);
+            return NULL;
+        }
     }
-    self->data[index] = value;
-    self->size++;
+    if (size > buffer->size) {
+        free(buffer->data);
+        buffer->data = malloc(size * sizeof(int));
+        buffer->size = buffer->data == NULL ? 0 : size;
+    }
+    return buffer->data;
 }
 
-void array_remove(struct array *self, size_t index) {
-    for (size_t i = index; i < self->size - 1; i++) {
-        self->data[i] = self->data[i + 1];
+/*
+ * Get a run length between 32 and 64 such that the array splits into a power of two runs, or slightly less
+ */
+size_t array_min_run_length(size_t size) {
+    size_t remainder = 0;
+    while (size >= 64) {
+        remainder |= size & 1;
+        size >>= 1;
     }
-    self->size--;
+    return size + remainder;
 }
 
-int array_get(const struct array *self, size_t index) {
-    return index >= self->size ? 0 : self->data[index];
+/*
+ * Get the length of the run starting at begin, reversing it if it is strictly descending
+ */
+size_t array_count_run(int *begin, int *end) {
+    int *cur = begin + 1;
+    if (cur == end) return 1;
+    if (*cur < *begin) {
+        while (cur < end && *cur < cur[-1]) cur++;
+        for (int *left = begin, *right = cur - 1; left < right; left++, right--) array_int_swap(left, right);
+    }
+    else {
+        while (cur < end && !(*cur < cur[-1])) cur++;
+    }
+    return (size_t) (cur - begin);
 }
 
-void array_set(struct array *self, size_t index, int value) {
-    if (index >= self->size) return;
-    self->data[index] = value;
+/*
+ * Insertion sort of [begin, end) knowing that [begin, sortedEnd) is sorted, inserting every value
+ * after the elements equal to it
+ */
+void array_binary_insertion_sort(int *begin, int *end, int *sortedEnd) {
+    for (int *cur = sortedEnd; cur < end; cur++) {
+        int value = *cur;
+        int *pos = begin + array_upper_bound_in(begin, (size_t) (cur - begin), value);
+        memmove(pos + 1, pos, (size_t) (cur - pos) * sizeof(int));
+        *pos = value;
+    }
 }
 
-size_t array_search(const struct array *self, int value) {
-    size_t i = 0;
-    for (; i < self->size; i++) {
-        if (self->data[i] == value) return i;
+/*
+ * Find the first position in the sorted data where value could be inserted, searching exponentially
+ * from hint before the final binary search
+ */
+size_t array_gallop_left(int value, const int *data, size_t size, size_t hint) {
+    ptrdiff_t lastOffset = 0;
+    ptrdiff_t offset = 1;
+    ptrdiff_t start = (ptrdiff_t) hint;
+    if (data[hint] < value) {
+        ptrdiff_t maxOffset = (ptrdiff_t) size - start;
+        while (offset < maxOffset && data[start + offset] < value) {
+            lastOffset = offset;
+            offset = 2 * offset + 1;
+        }
+        if (offset > maxOffset) offset = maxOffset;
+        lastOffset += start;
+        offset += start;
     }
-    return i;
+    else {
+        ptrdiff_t maxOffset = start + 1;
+        while (offset < maxOffset && !(data[start - offset] < value)) {
+            lastOffset = offset;
+            offset = 2 * offset + 1;
+        }
+        if (offset > maxOffset) offset = maxOffset;
+        ptrdiff_t previous = lastOffset;
+        lastOffset = start - offset;
+        offset = start - previous;
+    }
+    // data[lastOffset] < value <= data[offset]
+    lastOffset++;
+    while (lastOffset < offset) {
+        ptrdiff_t middle = lastOffset + (offset - lastOffset) / 2;
+        if (data[middle] < value) lastOffset = middle + 1;
+        else offset = middle;
+    }
+    return (size_t) offset;
 }
 
-size_t array_dicho_search(const struct array *self, int value, size_t start, size_t end) {
-    if (start == end) return self->size;
-    size_t middle = (start + end) / 2;
-    if (value < self->data[middle]) {
-        return array_dicho_search(self, value, start, middle);
+/*
+ * Find the last position in the sorted data where value could be inserted, searching exponentially
+ * from hint before the final binary search
+ */
+size_t array_gallop_right(int value, const int *data, size_t size, size_t hint) {
+    ptrdiff_t lastOffset = 0;
+    ptrdiff_t offset = 1;
+    ptrdiff_t start = (ptrdiff_t) hint;
+    if (value < data[hint]) {
+        ptrdiff_t maxOffset = start + 1;
+        while (offset < maxOffset && value < data[start - offset]) {
+            lastOffset = offset;
+            offset = 2 * offset + 1;
+        }
+        if (offset > maxOffset) offset = maxOffset;
+        ptrdiff_t previous = lastOffset;
+        lastOffset = start - offset;
+        offset = start - previous;
     }
-    if (self->data[middle] < value) {
-        return array_dicho_search(self, value, middle + 1, end);
+    else {
+        ptrdiff_t maxOffset = (ptrdiff_t) size - start;
+        while (offset < maxOffset && !(value < data[start + offset])) {
+            lastOffset = offset;
+            offset = 2 * offset + 1;
+        }
+        if (offset > maxOffset) offset = maxOffset;
+        lastOffset += start;
+        offset += start;
+    }
+    // data[lastOffset] <= value < data[offset]
+    lastOffset++;
+    while (lastOffset < offset) {
+        ptrdiff_t middle = lastOffset + (offset - lastOffset) / 2;
+        if (value < data[middle]) offset = middle;
+        else lastOffset = middle + 1;
     }
-    return middle;
+    return (size_t) offset;
 }
 
-size_t array_search_sorted(const struct array *self, int value) {
-    return array_dicho_search(self, value, 0, self->size);
+/*
+ * Merge the run a with the run b that follows it, when a is the shorter one
+ */
+void array_merge_low(struct array_stable_sort *sort, int *a, size_t sizeA, int *b, size_t sizeB) {
+    memcpy(sort->buffer, a, sizeA * sizeof(int));
+    int *dest = a;
+    int *curA = sort->buffer;
+    int *curB = b;
+    size_t minGallop = sort->minGallop;
+
+    *dest++ = *curB++;
+    if (--sizeB == 0) goto done;
+    if (sizeA == 1) goto copyB;
+
+    for (;;) {
+        size_t countA = 0;
+        size_t countB = 0;
+
+        // one element at a time until a run wins minGallop times in a row
+        for (;;) {
+            if (*curB < *curA) {
+                *dest++ = *curB++;
+                countB++;
+                countA = 0;
+                if (--sizeB == 0) goto done;
+                if (countB >= minGallop) break;
+            }
+            else {
+                *dest++ = *curA++;
+                countA++;
+                countB = 0;
+                if (--sizeA == 1) goto copyB;
+                if (countA >= minGallop) break;
+            }
+        }
+
+        // then gallop until it no longer pays off
+        minGallop++;
+        do {
+            minGallop -= minGallop > 1;
+            sort->minGallop = minGallop;
+            countA = array_gallop_right(*curB, curA, sizeA, 0);
+            if (countA > 0) {
+                memcpy(dest, curA, countA * sizeof(int));
+                dest += countA;
+                curA += countA;
+                sizeA -= countA;
+                if (sizeA == 1) goto copyB;
+                if (sizeA == 0) goto done;
+            }
+            *dest++ = *curB++;
+            if (--sizeB == 0) goto done;
+
+            countB = array_gallop_left(*curA, curB, sizeB, 0);
+            if (countB > 0) {
+                memmove(dest, curB, countB * sizeof(int));
+                dest += countB;
+                curB += countB;
+                sizeB -= countB;
+                if (sizeB == 0) goto done;
+            }
+            *dest++ = *curA++;
+            if (--sizeA == 1) goto copyB;
+        } while (countA >= ARRAY_STABLE_SORT_MIN_GALLOP || countB >= ARRAY_STABLE_SORT_MIN_GALLOP);
+        minGallop++;
+        sort->minGallop = minGallop;
+    }
+
+done:
+    if (sizeA > 0) memcpy(dest, curA, sizeA * sizeof(int));
+    return;
+
+copyB:
+    // the last element of a is greater than the rest of b
+    memmove(dest, curB, sizeB * sizeof(int));
+    dest[sizeB] = *curA;
 }
 
-bool array_is_sorted(const struct array *self) {
-    if (self->size < 2) return true;
-    for (size_t i = 0; i < self->size - 1; i++) {
-        if (self->data[i] > self->data[i + 1]) return false;
+/*
+ * Merge the run a with the run b that follows it, when b is the shorter one, starting from the end
+ */
+void array_merge_high(struct array_stable_sort *sort, int *a, size_t sizeA, int *b, size_t sizeB) {
+    memcpy(sort->buffer, b, sizeB * sizeof(int));
+    int *dest = b + sizeB - 1;
+    int *curA = a + sizeA - 1;
+    int *curB = sort->buffer + sizeB - 1;
+    size_t minGallop = sort->minGallop;
+
+    *dest-- = *curA--;
+    if (--sizeA == 0) goto done;
+    if (sizeB == 1) goto copyA;
+
+    for (;;) {
+        size_t countA = 0;
+        size_t countB = 0;
+
+        for (;;) {
+            if (*curB < *curA) {
+                *dest-- = *curA--;
+                countA++;
+                countB = 0;
+                if (--sizeA == 0) goto done;
+                if (countA >= minGallop) break;
+            }
+            else {
+                *dest-- = *curB--;
+                countB++;
+                countA = 0;
+                if (--sizeB == 1) goto copyA;
+                if (countB >= minGallop) break;
+            }
+        }
+
+        minGallop++;
+        do {
+            minGallop -= minGallop > 1;
+            sort->minGallop = minGallop;
+            countA = sizeA - array_gallop_right(*curB, a, sizeA, sizeA - 1);
+            if (countA > 0) {
+                dest -= countA;
+                curA -= countA;
+                memmove(dest + 1, curA + 1, countA * sizeof(int));
+                sizeA -= countA;
+                if (sizeA == 0) goto done;
+            }
+            *dest-- = *curB--;
+            if (--sizeB == 1) goto copyA;
+
+            countB = sizeB - array_gallop_left(*curA, sort->buffer, sizeB, sizeB - 1);
+            if (countB > 0) {
+                dest -= countB;
+                curB -= countB;
+                memcpy(dest + 1, curB + 1, countB * sizeof(int));
+                sizeB -= countB;
+                if (sizeB == 1) goto copyA;
+                if (sizeB == 0) goto done;
+            }
+            *dest-- = *curA--;
+            if (--sizeA == 0) goto done;
+        } while (countA >= ARRAY_STABLE_SORT_MIN_GALLOP || countB >= ARRAY_STABLE_SORT_MIN_GALLOP);
+        minGallop++;
+        sort->minGallop = minGallop;
     }
-    return true;
+
+done:
+    if (sizeB > 0) memcpy(dest - (sizeB - 1), sort->buffer, sizeB * sizeof(int));
+    return;
+
+copyA:
+    // the first element of b is smaller than the rest of a
+    dest -= sizeA;
+    curA -= sizeA;
+    memmove(dest + 1, curA + 1, sizeA * sizeof(int));
+    *dest = *curB;
 }
 
-void array_swap(struct array *self, size_t firstIndex, size_t secondIndex) {
-    if (firstIndex >= self->size || secondIndex >= self->size) return;
-    int temp = self->data[firstIndex];
-    self->data[firstIndex] = self->data[secondIndex];
-    self->data[secondIndex] = temp;
+/*
+ * Merge the runs i and i + 1 of the stack
+ */
+void array_merge_at(struct array_stable_sort *sort, size_t i) {
+    int *a = sort->runBase[i];
+    size_t sizeA = sort->runLength[i];
+    int *b = sort->runBase[i + 1];
+    size_t sizeB = sort->runLength[i + 1];
+
+    sort->runLength[i] = sizeA + sizeB;
+    if (i + 3 == sort->runCount) {
+        sort->runBase[i + 1] = sort->runBase[i + 2];
+        sort->runLength[i + 1] = sort->runLength[i + 2];
+    }
+    sort->runCount--;
+
+    // the elements of a already before b and the elements of b already after a stay in place
+    size_t skipped = array_gallop_right(*b, a, sizeA, 0);
+    a += skipped;
+    sizeA -= skipped;
+    if (sizeA == 0) return;
+    sizeB = array_gallop_left(a[sizeA - 1], b, sizeB, sizeB - 1);
+    if (sizeB == 0) return;
+
+    if (sizeA <= sizeB) array_merge_low(sort, a, sizeA, b, sizeB);
+    else array_merge_high(sort, a, sizeA, b, sizeB);
 }
 
-ptrdiff_t array_partition(struct array *self, ptrdiff_t i, ptrdiff_t j) {
-    ptrdiff_t pivotIndex = i;
-    const int pivot = self->data[i];
-    array_swap(self, pivotIndex, j);
-    ptrdiff_t l = i;
-    for (ptrdiff_t k = i; k < j; k++) {
-        if (self->data[k] < pivot) {
-            array_swap(self, k, l);
-            l++;
+/*
+ * Merge runs until every run on the stack is longer than the two above it combined
+ */
+void array_merge_collapse(struct array_stable_sort *sort) {
+    size_t *length = sort->runLength;
+    while (sort->runCount > 1) {
+        size_t i = sort->runCount - 2;
+        if ((i > 0 && length[i - 1] <= length[i] + length[i + 1])
+            || (i > 1 && length[i - 2] <= length[i - 1] + length[i])) {
+            if (length[i - 1] < length[i + 1]) i--;
+            array_merge_at(sort, i);
+        }
+        else if (length[i] <= length[i + 1]) {
+            array_merge_at(sort, i);
+        }
+        else {
+            break;
         }
     }
-    array_swap(self, l, j);
-    return l;
 }
 
-void array_quick_sort_recursive(struct array *self, ptrdiff_t i, ptrdiff_t j) {
-    if (i >= j) return;
-    ptrdiff_t p = array_partition(self, i, j);
-    array_quick_sort_recursive(self, i, p - 1);
-    array_quick_sort_recursive(self, p + 1, j);
+void array_stable_sort_range(int *begin, int *end, int *buffer) {
+    size_t size = (size_t) (end - begin);
+    if (size < 2) return;
+
+    struct array_stable_sort sort;
+    sort.buffer = buffer;
+    sort.minGallop = ARRAY_STABLE_SORT_MIN_GALLOP;
+    sort.runCount = 0;
+
+    size_t minRun = array_min_run_length(size);
+    int *cur = begin;
+    while (cur < end) {
+        size_t runLength = array_count_run(cur, end);
+        if (runLength < minRun) {
+            size_t forced = (size_t) (end - cur) < minRun ? (size_t) (end - cur) : minRun;
+            array_binary_insertion_sort(cur, cur + forced, cur + runLength);
+            runLength = forced;
+        }
+        sort.runBase[sort.runCount] = cur;
+        sort.runLength[sort.runCount] = runLength;
+        sort.runCount++;
+        array_merge_collapse(&sort);
+        cur += runLength;
+    }
+
+    while (sort.runCount > 1) {
+        size_t i = sort.runCount - 2;
+        if (i > 0 && sort.runLength[i - 1] < sort.runLength[i + 1]) i--;
+        array_merge_at(&sort, i);
+    }
 }
 
-void array_quick_sort(struct array *self) {
-    array_quick_sort_recursive(self, 0, (ptrdiff_t) self->size - 1);
+void array_stable_sort_with_buffer(struct array *self, int *buffer, size_t bufferSize) {
+    assert(bufferSize >= self->size / 2);
+    (void) bufferSize;
+    array_stable_sort_range(self->data, self->data + self->size, buffer);
 }
 
-bool array_heap_has_left_child(const struct array *self, size_t index) {
-    return 2 * index + 1 < self->size;
+void array_stable_sort(struct array *self) {
+    size_t needed = self->size / 2;
+    int *buffer = needed == 0 ? NULL : array_stable_sort_get_buffer(needed);
+    if (needed > 0 && buffer == NULL) {
+        // equal ints cannot be told apart, so an unstable in-place sort gives the same result
+        array_quick_sort(self);
+        return;
+    }
+    array_stable_sort_range(self->data, self->data + self->size, buffer);
 }
 
-bool array_heap_has_right_child(const struct array *self, size_t index) {
-    return 2 * index + 2 < self->size;
+void array_stable_sort_release_buffer(void) {
+    pthread_once(&array_stable_sort_key_once, array_stable_sort_key_init);
+    struct array_stable_sort_buffer *buffer = pthread_getspecific(array_stable_sort_key);
+    if (buffer == NULL) return;
+    free(buffer->data);
+    buffer->data = NULL;
+    buffer->size = 0;
 }
 
-size_t array_heap_left_index(const struct array *self, size_t index) {
-    assert(array_heap_has_left_child(self, index));
-    return 2 * index + 1;
+/*
+ * radix sort
+ */
+
+#define ARRAY_RADIX_BITS 11
+#define ARRAY_RADIX_BUCKETS (1 << ARRAY_RADIX_BITS)
+#define ARRAY_RADIX_PASSES ((32 + ARRAY_RADIX_BITS - 1) / ARRAY_RADIX_BITS)
+
+/*
+ * Map an int to an unsigned key with the same order by flipping the sign bit
+ */
+uint32_t array_radix_key(int value) {
+    return (uint32_t) value ^ UINT32_C(0x80000000);
 }
 
-size_t array_heap_right_index(const struct array *self, size_t index) {
-    assert(array_heap_has_right_child(self, index));
-    return 2 * index + 2;
+void array_radix_sort(struct array *self) {
+    size_t size = self->size;
+    if (size < 2) return;
+
+    size_t (*counts)[ARRAY_RADIX_BUCKETS] = calloc(ARRAY_RADIX_PASSES, sizeof(*counts));
+    if (counts == NULL) {
+        array_quick_sort(self);
+        return;
+    }
+    for (size_t i = 0; i < size; i++) {
+        uint32_t key = array_radix_key(self->data[i]);
+        for (unsigned pass = 0; pass < ARRAY_RADIX_PASSES; pass++) {
+            counts[pass][(key >> (pass * ARRAY_RADIX_BITS)) & (ARRAY_RADIX_BUCKETS - 1)]++;
+        }
+    }
+
+    int *from = self->data;
+    int *to = NULL;
+    for (unsigned pass = 0; pass < ARRAY_RADIX_PASSES; pass++) {
+        unsigned shift = pass * ARRAY_RADIX_BITS;
+        size_t *count = counts[pass];
+        // every value has the same digit: this pass would not move anything
+        if (count[(array_radix_key(from[0]) >> shift) & (ARRAY_RADIX_BUCKETS - 1)] == size) continue;
+
+        size_t offset = 0;
+        for (size_t bucket = 0; bucket < ARRAY_RADIX_BUCKETS; bucket++) {
+            size_t bucketSize = count[bucket];
+            count[bucket] = offset;
+            offset += bucketSize;
+        }
+        if (to == NULL) {
+            to = malloc(size * sizeof(int));
+            if (to == NULL) {
+                // no pass moved anything yet: the array can still be sorted in place
+                free(counts);
+                array_quick_sort(self);
+                return;
+            }
+        }
+        for (size_t i = 0; i < size; i++) {
+            int value = from[i];
+            to[count[(array_radix_key(value) >> shift) & (ARRAY_RADIX_BUCKETS - 1)]++] = value;
+        }
+        int *temp = from;
+        from = to;
+        to = temp;
+    }
+
+    if (from != self->data) memcpy(self->data, from, size * sizeof(int));
+    free(from == self->data ? to : from);
+    free(counts);
 }
 
 size_t array_heap_parent_index(size_t index) {
@@ -169,31 +2745,19 @@ size_t array_heap_parent_index(size_t index) {
 }
 
 void array_heap_sort(struct array *self) {
-    struct array temp;
-    array_create(&temp);
-    for (size_t i = 0; i < self->size; i++) array_heap_add(&temp, self->data[i]);
-    for (size_t i = 0; i < self->size; i++) {
-        self->data[self->size - i - 1] = array_heap_top(&temp);
-        array_heap_remove_top(&temp);
-    }
-    array_destroy(&temp);
+    array_heap_sort_range(self->data, self->data + self->size);
 }
 
-bool array_is_heap_recursive(const struct array *self, size_t index) {
-    if (array_heap_has_left_child(self, index)) {
-        if (array_get(self, index) < array_get(self, array_heap_left_index(self, index))) return false;
-        if (!array_is_heap_recursive(self, array_heap_left_index(self, index))) return false;
-    }
-    if (array_heap_has_right_child(self, index)) {
-        if (array_get(self, index) < array_get(self, array_heap_right_index(self, index))) return false;
-        if (!array_is_heap_recursive(self, array_heap_right_index(self, index))) return false;
-    }
-    return true;
+void array_heapify(struct array *self) {
+    array_heapify_range(self->data, self->size);
+}
+
+size_t array_is_heap_until(const struct array *self) {
+    return array_kernels()->is_heap_until(self->data, self->size);
 }
 
 bool array_is_heap(const struct array *self) {
-    if (self->size == 0) return true;
-    return array_is_heap_recursive(self, 0);
+    return array_is_heap_until(self) == self->size;
 }
 
 void array_heap_add(struct array *self, int value) {
@@ -213,20 +2777,288 @@ int array_heap_top(const struct array *self) {
 }
 
 void array_heap_remove_top(struct array *self) {
+    assert(self->size > 0);
+    self->size--;
+    if (self->size == 0) return;
+    self->data[0] = self->data[self->size];
+    array_sift_down(self->data, self->size, 0);
+}
+
+void array_heap_replace_top(struct array *self, int value) {
+    assert(self->size > 0);
+    self->data[0] = value;
+    array_sift_down(self->data, self->size, 0);
+}
+
+int array_heap_pushpop(struct array *self, int value) {
+    if (self->size == 0 || !(value < self->data[0])) return value;
+    int top = self->data[0];
+    array_heap_replace_top(self, value);
+    return top;
+}
+
+void array_heap_add_n(struct array *self, const int *values, size_t n) {
     size_t size = self->size;
-    self->data[0] = self->data[size - 1];
-    size_t i = 0;
-    while (i < (size - 1) / 2) {
-        size_t lt = 2 * i + 1;
-        size_t rt = 2 * i + 2;
-        if ((lt >= size || self->data[i] > self->data[lt]) && (rt >= size || self->data[i] > self->data[rt])) {
-            break;
+    array_push_back_n(self, values, n);
+    // rebuilding costs O(size + n), sifting every new value up costs O(n log(size + n))
+    if (n > size / 8) {
+        array_heapify(self);
+        return;
+    }
+    for (size_t i = size; i < self->size; i++) {
+        size_t index = i;
+        int value = self->data[index];
+        while (index > 0) {
+            size_t parent = (index - 1) / 2;
+            if (!(self->data[parent] < value)) break;
+            self->data[index] = self->data[parent];
+            index = parent;
         }
-        size_t j = (self->data[lt] > self->data[rt]) ? lt : rt;
-        array_swap(self, i, j);
-        i = j;
+        self->data[index] = value;
     }
-    self->size--;
+}
+
+/*
+ * top-k
+ *
+ * The heap stores the bitwise complement of the values: ~x reverses the order of the ints without
+ * overflowing, so the array max-heap of the complements is a min-heap of the values.
+ */
+
+void array_topk_create(struct array_topk *self, size_t k) {
+    assert(k > 0);
+    array_create_with_capacity(&self->heap, k);
+    self->k = k;
+}
+
+void array_topk_destroy(struct array_topk *self) {
+    array_destroy(&self->heap);
+}
+
+size_t array_topk_size(const struct array_topk *self) {
+    return self->heap.size;
+}
+
+int array_topk_threshold(const struct array_topk *self) {
+    return ~array_heap_top(&self->heap);
+}
+
+void array_topk_push(struct array_topk *self, int value) {
+    if (self->heap.size < self->k) {
+        array_heap_add(&self->heap, ~value);
+        return;
+    }
+    if (!(~value < self->heap.data[0])) return;
+    array_heap_replace_top(&self->heap, ~value);
+}
+
+void array_topk_push_n(struct array_topk *self, const int *values, size_t n) {
+    size_t i = 0;
+    if (self->heap.size < self->k) {
+        size_t fill = self->k - self->heap.size < n ? self->k - self->heap.size : n;
+        for (; i < fill; i++) self->heap.data[self->heap.size + i] = ~values[i];
+        self->heap.size += fill;
+        array_heapify(&self->heap);
+    }
+    if (i == n) return;
+    int threshold = self->heap.data[0];
+    for (; i < n; i++) {
+        if (!(~values[i] < threshold)) continue;
+        array_heap_replace_top(&self->heap, ~values[i]);
+        threshold = self->heap.data[0];
+    }
+}
+
+size_t array_topk_extract_sorted(struct array_topk *self, int *out) {
+    size_t size = self->heap.size;
+    array_heap_sort(&self->heap);
+    for (size_t i = 0; i < size; i++) out[i] = ~self->heap.data[i];
+    self->heap.size = 0;
+    return size;
+}
+
+/*
+ * d-ary heap
+ */
+
+void array_dheap_create(struct array_dheap *self, unsigned arity) {
+    assert(arity == 4 || arity == 8);
+    self->arity = arity;
+    self->size = 0;
+    self->capacity = 0;
+    self->block = NULL;
+    self->data = NULL;
+}
+
+void array_dheap_destroy(struct array_dheap *self) {
+    free(self->block);
+}
+
+bool array_dheap_empty(const struct array_dheap *self) {
+    return self->size == 0;
+}
+
+size_t array_dheap_size(const struct array_dheap *self) {
+    return self->size;
+}
+
+void array_dheap_increase_capacity(struct array_dheap *self) {
+    size_t capacity = self->capacity == 0 ? 64 : 2 * self->capacity;
+    // the children of node i start at data + arity * i + 1, so placing the root arity - 1 slots
+    // after a cache line boundary keeps every group of children inside one cache line
+    int *block = malloc((capacity + self->arity - 1 + 16) * sizeof(int));
+    if (block == NULL) array_capacity_failure(capacity);
+    uintptr_t address = (uintptr_t) block;
+    int *data = block + ((64 - address % 64) % 64) / sizeof(int) + self->arity - 1;
+    if (self->size > 0) memcpy(data, self->data, self->size * sizeof(int));
+    free(self->block);
+    self->block = block;
+    self->data = data;
+    self->capacity = capacity;
+}
+
+void array_dheap_add(struct array_dheap *self, int value) {
+    if (self->size == self->capacity) array_dheap_increase_capacity(self);
+    size_t index = self->size++;
+    while (index > 0) {
+        size_t parent = (index - 1) / self->arity;
+        if (!(self->data[parent] < value)) break;
+        self->data[index] = self->data[parent];
+        index = parent;
+    }
+    self->data[index] = value;
+}
+
+int array_dheap_top(const struct array_dheap *self) {
+    assert(self->size > 0);
+    return self->data[0];
+}
+
+/*
+ * Like array_sift_down_bottom_up: walk down to a leaf along the largest children without comparing
+ * the moved value, whose place is usually near the bottom, then bounce back up to it. Full groups of
+ * children are compared with the argmax kernel, looked up once for the whole walk.
+ */
+void array_dheap_remove_top(struct array_dheap *self) {
+    assert(self->size > 0);
+    size_t size = --self->size;
+    if (size == 0) return;
+    int *data = self->data;
+    size_t arity = self->arity;
+    size_t (*argmax)(const int *data) = arity == 8 ? array_kernels()->argmax8 : array_kernels()->argmax4;
+    int value = data[size];
+    size_t index = 0;
+    while (arity * index + arity < size) {
+        size_t first = arity * index + 1;
+        // the grandchildren are contiguous: fetch them while the children are compared
+        const int *grandchildren = data + arity * first + 1;
+        for (size_t line = 0; line < arity * arity + 16; line += 16) ARRAY_PREFETCH(grandchildren + line);
+        size_t child = first + argmax(data + first);
+        data[index] = data[child];
+        index = child;
+    }
+    if (arity * index + 1 < size) {
+        size_t first = arity * index + 1;
+        size_t child = first + array_argmax_scalar(data + first, size - first);
+        data[index] = data[child];
+        index = child;
+    }
+    while (index > 0) {
+        size_t parent = (index - 1) / arity;
+        if (!(data[parent] < value)) break;
+        data[index] = data[parent];
+        index = parent;
+    }
+    data[index] = value;
+}
+
+bool array_dheap_is_heap(const struct array_dheap *self) {
+    for (size_t i = 1; i < self->size; i++) {
+        if (self->data[(i - 1) / self->arity] < self->data[i]) return false;
+    }
+    return true;
+}
+
+size_t array_eytzinger_fill(struct array_eytzinger *self, const int *sorted, size_t i, size_t k) {
+    if (k > self->size) return i;
+    i = array_eytzinger_fill(self, sorted, i, 2 * k);
+    self->data[k] = sorted[i];
+    i++;
+    return array_eytzinger_fill(self, sorted, i, 2 * k + 1);
+}
+
+void array_build_eytzinger_index(struct array_eytzinger *self, const struct array *sorted) {
+    self->size = sorted->size;
+    // data itself is aligned on 64 bytes so that the slots 16k to 16k + 15, the descendants of k
+    // four levels down, fill exactly one cache line (slot 0 is unused)
+    self->block = malloc((self->size + 1 + 16) * sizeof(int));
+    uintptr_t address = (uintptr_t) self->block;
+    self->data = self->block + (((64 - address % 64) % 64) / sizeof(int));
+    array_eytzinger_fill(self, sorted->data, 0, 1);
+}
+
+void array_eytzinger_destroy(struct array_eytzinger *self) {
+    free(self->block);
+}
+
+size_t array_eytzinger_size(const struct array_eytzinger *self) {
+    return self->size;
+}
+
+/*
+ * Index of the highest set bit of a non-zero value
+ */
+unsigned array_log2(size_t value) {
+#ifdef __GNUC__
+    return (unsigned) (sizeof(unsigned long long) * CHAR_BIT - 1) - (unsigned) __builtin_clzll(value);
+#else
+    unsigned log = 0;
+    while (value >>= 1) log++;
+    return log;
+#endif
+}
+
+/*
+ * Get the index in the sorted array of the element in slot k. In the perfect tree with as many levels,
+ * the in-order position of k follows from its level and its offset in that level; the leaves missing
+ * from the last level sit at the even positions from 2 * present on, and are not counted.
+ */
+size_t array_eytzinger_rank(const struct array_eytzinger *self, size_t k) {
+    unsigned levels = array_log2(self->size);
+    unsigned depth = array_log2(k);
+    size_t position = ((2 * (k - ((size_t) 1 << depth)) + 1) << (levels - depth)) - 1;
+    size_t present = self->size - ((size_t) 1 << levels) + 1;
+    size_t leavesBefore = (position + 1) / 2;
+    return leavesBefore > present ? position - (leavesBefore - present) : position;
+}
+
+size_t array_eytzinger_lower_bound_slot(const struct array_eytzinger *self, int value) {
+    const int *data = self->data;
+    size_t k = 1;
+    while (k <= self->size) {
+        // the 16 descendants four levels down share one cache line
+        ARRAY_PREFETCH((const void *) ((uintptr_t) data + 16 * k * sizeof(int)));
+        k = 2 * k + (data[k] < value);
+    }
+    // the answer is the last node where the search went left
+#ifdef __GNUC__
+    k >>= __builtin_ctzll(~(unsigned long long) k) + 1;
+#else
+    while (k & 1) k >>= 1;
+    k >>= 1;
+#endif
+    return k;
+}
+
+size_t array_eytzinger_lower_bound(const struct array_eytzinger *self, int value) {
+    size_t k = array_eytzinger_lower_bound_slot(self, value);
+    return k == 0 ? self->size : array_eytzinger_rank(self, k);
+}
+
+size_t array_eytzinger_search(const struct array_eytzinger *self, int value) {
+    size_t k = array_eytzinger_lower_bound_slot(self, value);
+    if (k == 0 || self->data[k] != value) return self->size;
+    return array_eytzinger_rank(self, k);
 }
 
 
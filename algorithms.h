@@ -8,10 +8,96 @@
 extern "C" {
 #endif
 
+/*
+ * An allocator for the storage of arrays. The functions receive context as their first argument,
+ * and realloc and free also receive the size of the block given by the previous allocation.
+ */
+struct array_allocator {
+  void *(*alloc)(void *context, size_t size);
+  void *(*realloc)(void *context, void *ptr, size_t oldSize, size_t newSize);
+  void (*free)(void *context, void *ptr, size_t size);
+  void *context;
+};
+
+/*
+ * Set the allocator used by the arrays created from now on without an explicit allocator (NULL means malloc)
+ */
+void array_set_default_allocator(const struct array_allocator *allocator);
+
+struct array_arena_chunk;
+
+/*
+ * A bump allocator: allocations are carved out of large chunks and are only given back all at once,
+ * when the arena is reset or destroyed. Arrays allocated from an arena do not need to be destroyed
+ * one by one, but must not be used once the arena is reset or destroyed.
+ */
+struct array_arena {
+  struct array_allocator allocator;
+  struct array_arena_chunk *chunks;
+  size_t chunkSize;
+};
+
+/*
+ * Create an arena that allocates chunks of chunkSize bytes (0 means 64 KiB)
+ */
+void array_arena_create(struct array_arena *self, size_t chunkSize);
+
+/*
+ * Destroy an arena and release all the memory allocated from it
+ */
+void array_arena_destroy(struct array_arena *self);
+
+/*
+ * Release all the memory allocated from the arena, keeping one chunk for the next allocations
+ */
+void array_arena_reset(struct array_arena *self);
+
+/*
+ * Get the allocator that allocates from the arena
+ */
+const struct array_allocator *array_arena_allocator(struct array_arena *self);
+
+/*
+ * An allocator that aligns storage on 64 bytes (arrays small enough for their inline buffer are not
+ * concerned). Blocks of at least hugePageThreshold bytes are mapped
+ * directly and backed by transparent huge pages when the system allows it, which suits large arrays
+ * that are scanned or searched often.
+ */
+struct array_aligned_allocator {
+  struct array_allocator allocator;
+  size_t hugePageThreshold;
+};
+
+/*
+ * Create an aligned allocator (SIZE_MAX as threshold never maps blocks directly)
+ */
+void array_aligned_allocator_create(struct array_aligned_allocator *self, size_t hugePageThreshold);
+
+/*
+ * Get the allocator interface of an aligned allocator
+ */
+const struct array_allocator *array_aligned_allocator(struct array_aligned_allocator *self);
+
+/*
+ * Number of elements an array stores inside the struct before it needs a heap allocation,
+ * chosen so that the struct fills one 64-byte cache line on 64-bit targets
+ */
+#define ARRAY_INLINE_CAPACITY 6
+
+struct array_mapping;
+
+/*
+ * A dynamic array. Its first ARRAY_INLINE_CAPACITY elements live in inline_data, so data points
+ * inside the struct itself until the array spills to the heap: an array must not be copied or moved
+ * by value.
+ */
 struct array {
   int *data;
   size_t capacity;
   size_t size;
+  const struct array_allocator *allocator;
+  struct array_mapping *mapping;
+  int inline_data[ARRAY_INLINE_CAPACITY];
 };
 
 /*
@@ -19,11 +105,40 @@ struct array {
  */
 void array_create(struct array *self);
 
+/*
+ * Create an empty array able to hold capacity elements without reallocating
+ */
+void array_create_with_capacity(struct array *self, size_t capacity);
+
+/*
+ * Create an empty array whose storage comes from an allocator (NULL means the default allocator)
+ */
+void array_create_with_allocator(struct array *self, size_t capacity, const struct array_allocator *allocator);
+
 /*
  * Create an array with initial content
  */
 void array_create_from(struct array *self, const int *other, size_t size);
 
+/*
+ * Create an empty array stored in a file mapped in memory, replacing the file if it exists.
+ * Return false if the file cannot be created. Functions adding elements abort if the file cannot
+ * grow (no space left, file size limit): call array_reserve beforehand to handle it.
+ */
+bool array_create_mapped(struct array *self, const char *path);
+
+/*
+ * Open an array stored in a file by array_create_mapped, without copying it. A read-only array
+ * must not be modified. Return false if the file cannot be opened or is not a valid array file.
+ */
+bool array_open_mapped(struct array *self, const char *path, bool writable);
+
+/*
+ * Write the size of an array stored in a file and flush its content to the file
+ * (array_destroy does it too, and closes the file)
+ */
+void array_sync_mapped(struct array *self);
+
 /*
  * Destroy an array
  */
@@ -39,6 +154,27 @@ bool array_empty(const struct array *self);
  */
 size_t array_size(const struct array *self);
 
+/*
+ * Get the number of elements the array can hold without reallocating
+ */
+size_t array_capacity(const struct array *self);
+
+/*
+ * Make sure the array can hold at least capacity elements without reallocating.
+ * Tell if it succeeded: the allocator or the mapped file may not have room for them.
+ */
+bool array_reserve(struct array *self, size_t capacity);
+
+/*
+ * Release the unused capacity of the array
+ */
+void array_shrink_to_fit(struct array *self);
+
+/*
+ * Set the factor by which the capacity of every array grows when it is full (must be greater than 1, default is 2)
+ */
+void array_set_growth_factor(double factor);
+
 /*
  * Compare the array to another array (content and size)
  */
@@ -49,6 +185,21 @@ bool array_equals(const struct array *self, const int *content, size_t size);
  */
 void array_push_back(struct array *self, int value);
 
+/*
+ * Add n elements at the end of the array, reallocating at most once
+ */
+void array_push_back_n(struct array *self, const int *values, size_t n);
+
+/*
+ * Add all the elements of another array at the end of the array
+ */
+void array_append_array(struct array *self, const struct array *other);
+
+/*
+ * Replace the content of the array with n elements
+ */
+void array_assign(struct array *self, const int *values, size_t n);
+
 /*
  * Remove the element at the end of the array
  */
@@ -59,11 +210,36 @@ void array_pop_back(struct array *self);
  */
 void array_insert(struct array *self, int value, size_t index);
 
+/*
+ * Insert n elements in the array at the specified index (preserving the order)
+ */
+void array_insert_range(struct array *self, const int *values, size_t n, size_t index);
+
 /*
  * Remove an element in the array (preserving the order)
  */
 void array_remove(struct array *self, size_t index);
 
+/*
+ * Remove n elements in the array starting at the specified index (preserving the order)
+ */
+void array_remove_range(struct array *self, size_t index, size_t n);
+
+/*
+ * A function type that takes an int and a pointer and returns a bool
+ */
+typedef bool (*array_predicate_t)(int value, void *user_data);
+
+/*
+ * Remove every element for which the predicate is true (preserving the order) and return the number of removed elements
+ */
+size_t array_remove_if(struct array *self, array_predicate_t pred, void *user_data);
+
+/*
+ * Remove every element for which the predicate is false (preserving the order) and return the number of removed elements
+ */
+size_t array_retain(struct array *self, array_predicate_t pred, void *user_data);
+
 /*
  * Get an element at the specified index in the array, or 0 if the index is not valid
  */
@@ -79,11 +255,64 @@ void array_set(struct array *self, size_t index, int value);
  */
 size_t array_search(const struct array *self, int value);
 
+/*
+ * Count the occurrences of an element in the array
+ */
+size_t array_count(const struct array *self, int value);
+
+/*
+ * Search for every occurrence of an element in the array, store at most max of their indices
+ * in increasing order and return the number of occurrences
+ */
+size_t array_search_all(const struct array *self, int value, size_t *indices, size_t max);
+
+/*
+ * Instruction sets the array kernels can use
+ */
+enum array_simd {
+  ARRAY_SIMD_SCALAR,
+  ARRAY_SIMD_SSE42,
+  ARRAY_SIMD_AVX2,
+  ARRAY_SIMD_AVX512,
+};
+
+/*
+ * Get the instruction set used by the array kernels (the best one the CPU supports by default)
+ */
+enum array_simd array_get_simd(void);
+
+/*
+ * Restrict the array kernels to an instruction set and return the one actually used,
+ * which is lower if the CPU does not support the requested one. It must not run concurrently
+ * with any other array function.
+ */
+enum array_simd array_set_simd(enum array_simd simd);
+
 /*
  * Search for an element in the sorted array.
  */
 size_t array_search_sorted(const struct array *self, int value);
 
+/*
+ * Search for n elements in the sorted array and store in out the result array_search_sorted would give for each
+ */
+void array_search_sorted_batch(const struct array *self, const int *keys, size_t n, size_t *out);
+
+/*
+ * Get the index of the first element not less than value in the sorted array, or the size of the array if there is none
+ */
+size_t array_lower_bound(const struct array *self, int value);
+
+/*
+ * Get the index of the first element greater than value in the sorted array, or the size of the array if there is none
+ */
+size_t array_upper_bound(const struct array *self, int value);
+
+/*
+ * Get the range [first, last) of the elements equal to value in the sorted array
+ */
+void array_equal_range(const struct array *self, int value, size_t *first, size_t *last);
+
 /*
  * Tell if the array is sorted
  */
@@ -94,11 +323,70 @@ bool array_is_sorted(const struct array *self);
  */
 ptrdiff_t array_partition(struct array *self, ptrdiff_t i, ptrdiff_t j);
 
+/*
+ * Largest array that array_sort_small accepts
+ */
+#define ARRAY_SORT_SMALL_MAX 256
+
+/*
+ * Sort an array of at most ARRAY_SORT_SMALL_MAX elements with a sorting network in vector registers
+ * when the CPU has AVX2 or AVX-512, or with insertion sort otherwise
+ */
+void array_sort_small(struct array *self);
+
 /*
  * Sort the array with quick sort
  */
 void array_quick_sort(struct array *self);
 
+/*
+ * Sort the array with quick sort on several threads (0 means one per available core)
+ */
+void array_quick_sort_parallel(struct array *self, unsigned threads);
+
+/*
+ * Sort the array with sample sort on several threads (0 means one per available core)
+ */
+void array_sort_parallel(struct array *self, unsigned threads);
+
+/*
+ * Sort the array with a stable natural merge sort (TimSort), which runs in linear time on data made of
+ * a few sorted or reversed runs. The scratch buffer is cached between calls, per thread, and freed
+ * when the thread exits.
+ */
+void array_stable_sort(struct array *self);
+
+/*
+ * Sort the array like array_stable_sort, with a scratch buffer of at least half the size of the array
+ */
+void array_stable_sort_with_buffer(struct array *self, int *buffer, size_t bufferSize);
+
+/*
+ * Free the scratch buffer cached by array_stable_sort for the calling thread before it exits
+ */
+void array_stable_sort_release_buffer(void);
+
+/*
+ * Sort the array with radix sort
+ */
+void array_radix_sort(struct array *self);
+
+/*
+ * Rearrange the array so that the element at index k is the one that would be there if the array was sorted,
+ * with no greater element before it and no smaller element after it
+ */
+void array_nth_element(struct array *self, size_t k);
+
+/*
+ * Get the k-th smallest element of the array (starting at 0), rearranging the array like array_nth_element
+ */
+int array_select_kth(struct array *self, size_t k);
+
+/*
+ * Rearrange the array so that its first k elements are its k smallest elements in sorted order
+ */
+void array_partial_sort(struct array *self, size_t k);
+
 /*
  * Sort the array with heap sort
  */
@@ -109,6 +397,16 @@ void array_heap_sort(struct array *self);
  */
 bool array_is_heap(const struct array *self);
 
+/*
+ * Get the index of the first element greater than its parent, or the size of the array if it is a heap
+ */
+size_t array_is_heap_until(const struct array *self);
+
+/*
+ * Rearrange the array into a heap in linear time
+ */
+void array_heapify(struct array *self);
+
 /*
  * Add a value into the array considered as a heap
  */
@@ -124,6 +422,155 @@ int array_heap_top(const struct array *self);
  */
 void array_heap_remove_top(struct array *self);
 
+/*
+ * Replace the top value in the array considered as a heap with a new value
+ */
+void array_heap_replace_top(struct array *self, int value);
+
+/*
+ * Add a value into the array considered as a heap, then remove the top value and return it
+ */
+int array_heap_pushpop(struct array *self, int value);
+
+/*
+ * Add n values into the array considered as a heap
+ */
+void array_heap_add_n(struct array *self, const int *values, size_t n);
+
+
+/*
+ * The k largest values of a stream, kept in a min-heap of at most k elements so that a value
+ * below the smallest one kept is discarded with a single comparison. Like an array, it must not
+ * be copied or moved by value.
+ */
+struct array_topk {
+  struct array heap;
+  size_t k;
+};
+
+/*
+ * Create an empty top-k container keeping the k largest values pushed
+ */
+void array_topk_create(struct array_topk *self, size_t k);
+
+/*
+ * Destroy a top-k container
+ */
+void array_topk_destroy(struct array_topk *self);
+
+/*
+ * Get the number of values currently kept, which is at most k
+ */
+size_t array_topk_size(const struct array_topk *self);
+
+/*
+ * Get the smallest value kept, which a new value must exceed to be kept once k values are kept
+ */
+int array_topk_threshold(const struct array_topk *self);
+
+/*
+ * Push a value into the top-k container
+ */
+void array_topk_push(struct array_topk *self, int value);
+
+/*
+ * Push n values into the top-k container
+ */
+void array_topk_push_n(struct array_topk *self, const int *values, size_t n);
+
+/*
+ * Write the values kept in decreasing order into out, which must have room for array_topk_size values,
+ * and empty the container. Return the number of values written.
+ */
+size_t array_topk_extract_sorted(struct array_topk *self, int *out);
+
+/*
+ * A max-heap where every node has arity children (4 or 8), laid out so that the children
+ * of a node always share a cache line
+ */
+struct array_dheap {
+  int *data;
+  size_t size;
+  size_t capacity;
+  unsigned arity;
+  int *block;
+};
+
+/*
+ * Create an empty d-ary heap with 4 or 8 children per node
+ */
+void array_dheap_create(struct array_dheap *self, unsigned arity);
+
+/*
+ * Destroy a d-ary heap
+ */
+void array_dheap_destroy(struct array_dheap *self);
+
+/*
+ * Tell if the d-ary heap is empty
+ */
+bool array_dheap_empty(const struct array_dheap *self);
+
+/*
+ * Get the size of the d-ary heap
+ */
+size_t array_dheap_size(const struct array_dheap *self);
+
+/*
+ * Add a value into the d-ary heap
+ */
+void array_dheap_add(struct array_dheap *self, int value);
+
+/*
+ * Get the value at the top of the d-ary heap
+ */
+int array_dheap_top(const struct array_dheap *self);
+
+/*
+ * Remove the top value of the d-ary heap
+ */
+void array_dheap_remove_top(struct array_dheap *self);
+
+/*
+ * Tell if the d-ary heap satisfies the heap property
+ */
+bool array_dheap_is_heap(const struct array_dheap *self);
+
+/*
+ * A read-only copy of a sorted array in Eytzinger (breadth-first) order, so that a search touches
+ * one cache line per level of the implicit tree
+ */
+struct array_eytzinger {
+  int *data;
+  size_t size;
+  int *block;
+};
+
+/*
+ * Build a search index from a sorted array. The array can be modified or destroyed afterwards.
+ */
+void array_build_eytzinger_index(struct array_eytzinger *self, const struct array *sorted);
+
+/*
+ * Destroy a search index
+ */
+void array_eytzinger_destroy(struct array_eytzinger *self);
+
+/*
+ * Get the number of elements in the search index
+ */
+size_t array_eytzinger_size(const struct array_eytzinger *self);
+
+/*
+ * Search for an element in the index and return its index in the sorted array, like array_search_sorted
+ */
+size_t array_eytzinger_search(const struct array_eytzinger *self, int value);
+
+/*
+ * Get the index in the sorted array of the first element not less than value, like array_lower_bound
+ */
+size_t array_eytzinger_lower_bound(const struct array_eytzinger *self, int value);
+
 
 
 struct list_node {
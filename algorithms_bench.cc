@@ -0,0 +1,96 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "algorithms.h"
+
+/*
+ * Benchmarks, run with make bench. Every measure is the best of a few runs, to filter out noise.
+ */
+
+#define BENCH_RUNS 3
+
+static double now() {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/*
+ * Pop every element of a heap built from values, with the binary heap of struct array
+ */
+static double bench_binary_heap(const std::vector<int>& values, long long *sum) {
+  struct array a;
+  array_create(&a);
+  array_heap_add_n(&a, values.data(), values.size());
+
+  double start = now();
+  *sum = 0;
+  while (!array_empty(&a)) {
+    *sum += array_heap_top(&a);
+    array_heap_remove_top(&a);
+  }
+  double elapsed = now() - start;
+
+  array_destroy(&a);
+  return elapsed;
+}
+
+/*
+ * Pop every element of a heap built from values, with a d-ary heap
+ */
+static double bench_dheap(const std::vector<int>& values, unsigned arity, long long *sum) {
+  struct array_dheap h;
+  array_dheap_create(&h, arity);
+  for (int value : values) {
+    array_dheap_add(&h, value);
+  }
+
+  double start = now();
+  *sum = 0;
+  while (!array_dheap_empty(&h)) {
+    *sum += array_dheap_top(&h);
+    array_dheap_remove_top(&h);
+  }
+  double elapsed = now() - start;
+
+  array_dheap_destroy(&h);
+  return elapsed;
+}
+
+static const char *simd_name(int simd) {
+  static const char *names[] = { "scalar", "sse4.2", "avx2", "avx512" };
+  return names[simd];
+}
+
+int main(int argc, char *argv[]) {
+  size_t size = argc > 1 ? std::strtoul(argv[1], NULL, 10) : 8u << 20;
+
+  std::mt19937 random(42);
+  std::vector<int> values(size);
+  for (int& value : values) {
+    value = static_cast<int>(random());
+  }
+
+  std::printf("remove_top of %zu random ints, seconds\n", size);
+  std::printf("%-8s %10s %10s %10s\n", "simd", "binary", "4-ary", "8-ary");
+
+  for (int simd = ARRAY_SIMD_SCALAR; simd <= ARRAY_SIMD_AVX512; ++simd) {
+    if (array_set_simd(static_cast<enum array_simd>(simd)) != simd) continue;
+
+    double best[3] = { 1e9, 1e9, 1e9 };
+    for (int run = 0; run < BENCH_RUNS; ++run) {
+      long long expected, sum;
+      best[0] = std::min(best[0], bench_binary_heap(values, &expected));
+      best[1] = std::min(best[1], bench_dheap(values, 4, &sum));
+      if (sum != expected) return EXIT_FAILURE;
+      best[2] = std::min(best[2], bench_dheap(values, 8, &sum));
+      if (sum != expected) return EXIT_FAILURE;
+    }
+
+    std::printf("%-8s %10.3f %10.3f %10.3f\n", simd_name(simd), best[0], best[1], best[2]);
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -1,10 +1,16 @@
 #include "gtest/gtest.h"
 
 #include <cassert>
+#include <climits>
+#include <cstdint>
 #include <cstdlib>
 #include <cstdio>
 #include <cstring>
+#include <algorithm>
 #include <array>
+#include <functional>
+#include <string>
+#include <vector>
 
 #include "algorithms.h"
 
@@ -24,698 +30,2321 @@ TEST(ArrayCreateTest, Empty) {
   array_destroy(&a);
 }
 
-/*
- * array_create_from
- */
-
-TEST(ArrayCreateFromTest, OneElement) {
-  static const int origin[] = { 1 };
-
+TEST(ArrayCreateTest, Inline) {
   struct array a;
-  array_create_from(&a, origin, std::size(origin));
+  array_create(&a);
 
-  EXPECT_FALSE(array_empty(&a));
-  EXPECT_EQ(array_size(&a), std::size(origin));
-  EXPECT_TRUE(array_equals(&a, origin, std::size(origin)));
+  for (int i = 0; i < ARRAY_INLINE_CAPACITY; ++i) {
+    array_push_back(&a, i);
+    EXPECT_EQ(a.data, a.inline_data);
+  }
 
-  array_destroy(&a);
-}
+  array_push_back(&a, ARRAY_INLINE_CAPACITY);
+  EXPECT_NE(a.data, a.inline_data);
 
-TEST(ArrayCreateFromTest, ManyElements) {
-  static const int origin[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+  for (int i = 0; i <= ARRAY_INLINE_CAPACITY; ++i) {
+    EXPECT_EQ(array_get(&a, i), i);
+  }
 
-  struct array a;
-  array_create_from(&a, origin, std::size(origin));
+  array_pop_back(&a);
+  array_pop_back(&a);
+  array_shrink_to_fit(&a);
+  EXPECT_EQ(a.data, a.inline_data);
 
-  EXPECT_FALSE(array_empty(&a));
-  EXPECT_EQ(array_size(&a), std::size(origin));
-  EXPECT_TRUE(array_equals(&a, origin, std::size(origin)));
+  for (int i = 0; i < ARRAY_INLINE_CAPACITY - 1; ++i) {
+    EXPECT_EQ(array_get(&a, i), i);
+  }
 
   array_destroy(&a);
 }
 
 /*
- * array_equals
+ * array_create_with_capacity
  */
 
-TEST(ArrayEqualsTest, DifferentElement) {
-  static const int origin[]    = { 1, 2, 3, 4, 5, 6, 7, 8, 9 };
-  static const int reference[] = { 1, 2, 3, 4, 5, 6, 7, 8, 10 };
-
+TEST(ArrayCreateWithCapacityTest, Empty) {
   struct array a;
-  array_create_from(&a, origin, std::size(origin));
+  array_create_with_capacity(&a, 100);
 
-  EXPECT_FALSE(array_equals(&a, reference, std::size(reference)));
+  EXPECT_TRUE(array_empty(&a));
+  EXPECT_EQ(array_size(&a), 0u);
+  EXPECT_GE(array_capacity(&a), 100u);
 
   array_destroy(&a);
 }
 
-TEST(ArrayEqualsTest, SizeShorter) {
-  static const int origin[]    = { 1, 2, 3, 4, 5, 6, 7, 8, 9 };
-  static const int reference[] = { 1, 2, 3, 4, 5, 6, 7, 8 };
-
+TEST(ArrayCreateWithCapacityTest, NoCapacity) {
   struct array a;
-  array_create_from(&a, origin, std::size(origin));
+  array_create_with_capacity(&a, 0);
 
-  EXPECT_FALSE(array_equals(&a, reference, std::size(reference)));
-
-  array_destroy(&a);
-}
-
-TEST(ArrayEqualsTest, SizeLarger) {
-  static const int origin[]    = { 1, 2, 3, 4, 5, 6, 7, 8, 9 };
-  static const int reference[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+  for (int i = 0; i < BIG_SIZE; ++i) {
+    array_push_back(&a, i);
+  }
 
-  struct array a;
-  array_create_from(&a, origin, std::size(origin));
+  EXPECT_EQ(array_size(&a), static_cast<std::size_t>(BIG_SIZE));
 
-  EXPECT_FALSE(array_equals(&a, reference, std::size(reference)));
+  for (int i = 0; i < BIG_SIZE; ++i) {
+    EXPECT_EQ(array_get(&a, i), i);
+  }
 
   array_destroy(&a);
 }
 
 /*
- * array_push_back
+ * array_reserve
  */
 
-TEST(ArrayPushBackTest, OneElement) {
+TEST(ArrayReserveTest, NoReallocation) {
   struct array a;
   array_create(&a);
-  array_push_back(&a, 1);
-
-  EXPECT_FALSE(array_empty(&a));
-  EXPECT_TRUE(array_size(&a) == 1);
-  EXPECT_EQ(array_get(&a, 0), 1);
+  array_reserve(&a, BIG_SIZE);
 
-  array_destroy(&a);
-}
+  EXPECT_GE(array_capacity(&a), static_cast<std::size_t>(BIG_SIZE));
+  array_push_back(&a, 0);
+  const int *data = &a.data[0];
 
-TEST(ArrayPushBackTest, ManyElements) {
-  static const int origin[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+  for (int i = 1; i < BIG_SIZE; ++i) {
+    array_push_back(&a, i);
+  }
 
-  struct array a;
-  array_create(&a);
+  EXPECT_EQ(data, &a.data[0]);
 
-  for (size_t i = 0; i < std::size(origin); ++i) {
-    array_push_back(&a, origin[i]);
+  for (int i = 0; i < BIG_SIZE; ++i) {
+    EXPECT_EQ(array_get(&a, i), i);
   }
 
-  EXPECT_FALSE(array_empty(&a));
-  EXPECT_EQ(array_size(&a), std::size(origin));
+  array_destroy(&a);
+}
 
+TEST(ArrayReserveTest, Smaller) {
+  static const int origin[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9 };
 
-  for (size_t i = 0; i < std::size(origin); ++i) {
-    EXPECT_EQ(array_get(&a, i), origin[i]);
-  }
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+  array_reserve(&a, 2);
 
+  EXPECT_GE(array_capacity(&a), std::size(origin));
   EXPECT_TRUE(array_equals(&a, origin, std::size(origin)));
 
   array_destroy(&a);
 }
 
-TEST(ArrayPushBackTest, Stressed) {
-  struct array a;
-
-  array_create(&a);
+TEST(ArrayReserveTest, Overflow) {
+  static const int origin[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
 
-  for (int i = 0; i < BIG_SIZE; ++i) {
-    array_push_back(&a, i + 1);
-    EXPECT_EQ(array_size(&a), static_cast<std::size_t>(i + 1));
-  }
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+  size_t capacity = array_capacity(&a);
 
-  EXPECT_FALSE(array_empty(&a));
+  EXPECT_FALSE(array_reserve(&a, SIZE_MAX / sizeof(int) + 2));
+  EXPECT_FALSE(array_reserve(&a, SIZE_MAX));
 
-  for (int i = 0; i < BIG_SIZE; ++i) {
-    EXPECT_EQ(array_get(&a, i), i + 1);
-  }
+  EXPECT_EQ(array_capacity(&a), capacity);
+  EXPECT_TRUE(array_equals(&a, origin, std::size(origin)));
 
   array_destroy(&a);
 }
 
 /*
- * array_pop_back
+ * array_shrink_to_fit
  */
 
-TEST(ArrayPopBackTest, OneElement) {
+TEST(ArrayShrinkToFitTest, ManyElements) {
   static const int origin[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9 };
 
   struct array a;
-  array_create_from(&a, origin, std::size(origin));
+  array_create_with_capacity(&a, BIG_SIZE);
 
-  EXPECT_EQ(array_size(&a), std::size(origin));
+  for (size_t i = 0; i < std::size(origin); ++i) {
+    array_push_back(&a, origin[i]);
+  }
 
-  array_pop_back(&a);
+  array_shrink_to_fit(&a);
 
-  EXPECT_EQ(array_size(&a), std::size(origin) - 1);
+  EXPECT_EQ(array_capacity(&a), std::size(origin));
+  EXPECT_TRUE(array_equals(&a, origin, std::size(origin)));
 
-  for (std::size_t i = 0; i < std::size(origin) - 1; ++i) {
-    EXPECT_EQ(array_get(&a, i), origin[i]);
-  }
+  array_push_back(&a, 10);
+  EXPECT_EQ(array_size(&a), std::size(origin) + 1);
+  EXPECT_EQ(array_get(&a, std::size(origin)), 10);
 
   array_destroy(&a);
 }
 
-TEST(ArrayPopBackTest, ManyElements) {
-  static const int origin[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9 };
-
+TEST(ArrayShrinkToFitTest, Empty) {
   struct array a;
-  array_create_from(&a, origin, std::size(origin));
-
-  EXPECT_EQ(array_size(&a), std::size(origin));
-
-  for (std::size_t i = 0; i < std::size(origin); ++i) {
-    array_pop_back(&a);
-  }
+  array_create(&a);
+  array_shrink_to_fit(&a);
 
   EXPECT_TRUE(array_empty(&a));
-  EXPECT_EQ(array_size(&a), 0u);
+  EXPECT_EQ(array_capacity(&a), static_cast<size_t>(ARRAY_INLINE_CAPACITY));
+
+  array_push_back(&a, 1);
+  EXPECT_EQ(array_get(&a, 0), 1);
 
   array_destroy(&a);
 }
 
 /*
- * array_insert
+ * array_create_with_allocator
  */
 
-TEST(ArrayInsertTest, Beginning) {
-  static const int origin[] = { 9, 3, 7, 2, 4, 0, 8 };
-  static const int expected[] = { 42, 9, 3, 7, 2, 4, 0, 8 };
-
-  struct array a;
-  array_create_from(&a, origin, std::size(origin));
+struct counting_allocator {
+  int allocs;
+  int reallocs;
+  int frees;
+};
 
-  array_insert(&a, 42, 0); // insert at the beginning
+static void *counting_alloc(void *context, size_t size) {
+  static_cast<counting_allocator *>(context)->allocs++;
+  return std::malloc(size);
+}
 
-  EXPECT_EQ(array_size(&a), std::size(expected));
-  EXPECT_TRUE(array_equals(&a, expected, std::size(expected)));
+static void *counting_realloc(void *context, void *ptr, size_t, size_t newSize) {
+  static_cast<counting_allocator *>(context)->reallocs++;
+  return std::realloc(ptr, newSize);
+}
 
-  array_destroy(&a);
+static void counting_free(void *context, void *ptr, size_t) {
+  static_cast<counting_allocator *>(context)->frees++;
+  std::free(ptr);
 }
 
-TEST(ArrayInsertTest, Middle) {
-  static const int origin[] = { 9, 3, 7, 2, 4, 0, 8 };
-  static const int expected[] = { 9, 3, 7, 42, 2, 4, 0, 8 };
+TEST(ArrayCreateWithAllocatorTest, Custom) {
+  counting_allocator counts = { 0, 0, 0 };
+  const struct array_allocator allocator = { counting_alloc, counting_realloc, counting_free, &counts };
 
   struct array a;
-  array_create_from(&a, origin, std::size(origin));
+  array_create_with_allocator(&a, 0, &allocator);
 
-  array_insert(&a, 42, 3); // insert in the middle
+  for (int i = 0; i < BIG_SIZE; ++i) {
+    array_push_back(&a, i);
+  }
 
-  EXPECT_EQ(array_size(&a), std::size(expected));
-  EXPECT_TRUE(array_equals(&a, expected, std::size(expected)));
+  for (int i = 0; i < BIG_SIZE; ++i) {
+    EXPECT_EQ(array_get(&a, i), i);
+  }
 
   array_destroy(&a);
+
+  EXPECT_EQ(counts.allocs, 1);
+  EXPECT_GT(counts.reallocs, 0);
+  EXPECT_EQ(counts.frees, 1);
 }
 
-TEST(ArrayInsertTest, End) {
-  static const int origin[] = { 9, 3, 7, 2, 4, 0, 8 };
-  static const int expected[] = { 9, 3, 7, 2, 4, 0, 8, 42 };
+TEST(ArrayCreateWithAllocatorTest, Default) {
+  counting_allocator counts = { 0, 0, 0 };
+  const struct array_allocator allocator = { counting_alloc, counting_realloc, counting_free, &counts };
+
+  array_set_default_allocator(&allocator);
 
   struct array a;
-  array_create_from(&a, origin, std::size(origin));
+  array_create_with_capacity(&a, BIG_SIZE);
 
-  array_insert(&a, 42, std::size(origin)); // insert at the end
+  array_set_default_allocator(NULL);
 
-  EXPECT_EQ(array_size(&a), std::size(expected));
-  EXPECT_TRUE(array_equals(&a, expected, std::size(expected)));
+  struct array b;
+  array_create_with_capacity(&b, BIG_SIZE);
 
   array_destroy(&a);
+  array_destroy(&b);
+
+  EXPECT_EQ(counts.allocs, 1);
+  EXPECT_EQ(counts.frees, 1);
 }
 
-TEST(ArrayInsertTest, Stressed) {
-  static const int origin[] = { 9, 3, 7, 2, 4, 0, 8 };
+/*
+ * array_arena
+ */
 
-  struct array a;
-  array_create_from(&a, origin, std::size(origin));
+TEST(ArrayArenaTest, ManyArrays) {
+  struct array_arena arena;
+  array_arena_create(&arena, 1024);
+
+  struct array arrays[10];
+
+  for (auto& a : arrays) {
+    array_create_with_allocator(&a, 0, array_arena_allocator(&arena));
+  }
 
   for (int i = 0; i < BIG_SIZE; ++i) {
-    array_insert(&a, i + 1, 4);
-    EXPECT_EQ(array_size(&a), std::size(origin) + i + 1);
+    for (auto& a : arrays) {
+      array_push_back(&a, i);
+    }
   }
 
-  array_destroy(&a);
+  for (auto& a : arrays) {
+    EXPECT_EQ(array_size(&a), static_cast<size_t>(BIG_SIZE));
+
+    for (int i = 0; i < BIG_SIZE; ++i) {
+      EXPECT_EQ(array_get(&a, i), i);
+    }
+  }
+
+  array_arena_destroy(&arena);
 }
 
+TEST(ArrayArenaTest, Reset) {
+  static const int origin[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9 };
 
-/*
- * array_remove
- */
+  struct array_arena arena;
+  array_arena_create(&arena, 0);
 
-TEST(ArrayRemoveTest, Beginning) {
-  static const int origin[] = { 9, 3, 7, 2, 4, 0, 8 };
-  static const int expected[] = { 3, 7, 2, 4, 0, 8 };
+  for (int round = 0; round < 3; ++round) {
+    struct array a;
+    array_create_with_allocator(&a, 0, array_arena_allocator(&arena));
+    array_push_back_n(&a, origin, std::size(origin));
 
-  struct array a;
-  array_create_from(&a, origin, std::size(origin));
+    struct array b;
+    array_create_with_allocator(&b, BIG_SIZE, array_arena_allocator(&arena));
+    array_append_array(&b, &a);
 
-  array_remove(&a, 0); // remove at the beginning
+    EXPECT_TRUE(array_equals(&a, origin, std::size(origin)));
+    EXPECT_TRUE(array_equals(&b, origin, std::size(origin)));
 
-  EXPECT_EQ(array_size(&a), std::size(expected));
-  EXPECT_TRUE(array_equals(&a, expected, std::size(expected)));
+    array_arena_reset(&arena);
+  }
 
-  array_destroy(&a);
+  array_arena_destroy(&arena);
 }
 
-TEST(ArrayRemoveTest, Middle) {
-  static const int origin[] = { 9, 3, 7, 2, 4, 0, 8 };
-  static const int expected[] = { 9, 3, 7, 4, 0, 8 };
+/*
+ * array_aligned_allocator
+ */
+
+TEST(ArrayAlignedAllocatorTest, Small) {
+  struct array_aligned_allocator allocator;
+  array_aligned_allocator_create(&allocator, SIZE_MAX);
 
   struct array a;
-  array_create_from(&a, origin, std::size(origin));
+  array_create_with_allocator(&a, 0, array_aligned_allocator(&allocator));
 
-  array_remove(&a, 3); // remove in the middle
+  for (int i = 0; i < BIG_SIZE; ++i) {
+    array_push_back(&a, i);
 
-  EXPECT_EQ(array_size(&a), std::size(expected));
-  EXPECT_TRUE(array_equals(&a, expected, std::size(expected)));
+    if (a.data != a.inline_data) {
+      EXPECT_EQ(reinterpret_cast<uintptr_t>(a.data) % 64, 0u);
+    }
+  }
+
+  for (int i = 0; i < BIG_SIZE; ++i) {
+    EXPECT_EQ(array_get(&a, i), i);
+  }
+
+  array_shrink_to_fit(&a);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(a.data) % 64, 0u);
 
   array_destroy(&a);
 }
 
-TEST(ArrayRemoveTest, End) {
-  static const int origin[] = { 9, 3, 7, 2, 4, 0, 8 };
-  static const int expected[] = { 9, 3, 7, 2, 4, 0 };
+TEST(ArrayAlignedAllocatorTest, HugePages) {
+  static const int size = 4 * 1024 * 1024;
+
+  struct array_aligned_allocator allocator;
+  array_aligned_allocator_create(&allocator, 1024 * 1024);
 
   struct array a;
-  array_create_from(&a, origin, std::size(origin));
+  array_create_with_allocator(&a, 0, array_aligned_allocator(&allocator));
 
-  array_remove(&a, std::size(origin) - 1); // remove at the end
+  for (int i = 0; i < size; ++i) {
+    array_push_back(&a, i);
+  }
 
-  EXPECT_EQ(array_size(&a), std::size(expected));
-  EXPECT_TRUE(array_equals(&a, expected, std::size(expected)));
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(a.data) % 64, 0u);
+
+  for (int i = 0; i < size; ++i) {
+    ASSERT_EQ(array_get(&a, i), i);
+  }
+
+  array_shrink_to_fit(&a);
+  EXPECT_EQ(array_get(&a, size - 1), size - 1);
+
+  array_remove_range(&a, 10, size - 10);
+  array_shrink_to_fit(&a);
+  EXPECT_EQ(array_size(&a), 10u);
+  EXPECT_EQ(array_get(&a, 9), 9);
 
   array_destroy(&a);
 }
 
 /*
- * array_get
+ * array_create_from
  */
 
-TEST(ArrayGetTest, ValidIndex) {
-  static const int origin[] = { 9, 3, 7, 2, 4, 0, 8 };
+TEST(ArrayCreateFromTest, OneElement) {
+  static const int origin[] = { 1 };
 
   struct array a;
   array_create_from(&a, origin, std::size(origin));
 
-  for (std::size_t i = 0; i < std::size(origin); ++i) {
-    EXPECT_EQ(array_get(&a, i), origin[i]);
-  }
+  EXPECT_FALSE(array_empty(&a));
+  EXPECT_EQ(array_size(&a), std::size(origin));
+  EXPECT_TRUE(array_equals(&a, origin, std::size(origin)));
 
   array_destroy(&a);
 }
 
-TEST(ArrayGetTest, NotValidIndex) {
-  static const int origin[] = { 9, 3, 7, 2, 4, 0, 8 };
+TEST(ArrayCreateFromTest, ManyElements) {
+  static const int origin[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9 };
 
   struct array a;
   array_create_from(&a, origin, std::size(origin));
 
-  EXPECT_EQ(array_get(&a, std::size(origin)), 0);
-  EXPECT_EQ(array_get(&a, -1), 0);
+  EXPECT_FALSE(array_empty(&a));
+  EXPECT_EQ(array_size(&a), std::size(origin));
+  EXPECT_TRUE(array_equals(&a, origin, std::size(origin)));
 
   array_destroy(&a);
 }
 
 /*
- * array_set
+ * array_create_mapped
  */
 
-TEST(ArraySetTest, ValidIndex) {
-  static const int origin[] = { 9, 3, 7, 2, 4, 0, 8 };
+TEST(ArrayMappedTest, CreateAndOpen) {
+  const std::string path = testing::TempDir() + "array_mapped_create_and_open";
 
   struct array a;
-  array_create_from(&a, origin, std::size(origin));
+  ASSERT_TRUE(array_create_mapped(&a, path.c_str()));
+  EXPECT_TRUE(array_empty(&a));
 
-  for (std::size_t i = 0; i < std::size(origin); ++i) {
-    array_set(&a, i, origin[i] - 1);
-    EXPECT_EQ(array_get(&a, i), origin[i] - 1);
+  for (int i = 0; i < 100 * BIG_SIZE; ++i) {
+    array_push_back(&a, 2 * i);
   }
 
-  EXPECT_EQ(array_size(&a), std::size(origin));
-
   array_destroy(&a);
-}
 
-TEST(ArraySetTest, NotValidIndex) {
-  static const int origin[] = { 9, 3, 7, 2, 4, 0, 8 };
+  struct array b;
+  ASSERT_TRUE(array_open_mapped(&b, path.c_str(), false));
 
-  struct array a;
-  array_create_from(&a, origin, std::size(origin));
+  EXPECT_EQ(array_size(&b), static_cast<size_t>(100 * BIG_SIZE));
+  EXPECT_TRUE(array_is_sorted(&b));
+  EXPECT_EQ(array_get(&b, 42), 84);
+  EXPECT_EQ(array_search_sorted(&b, 2 * 1234), 1234u);
+  EXPECT_EQ(array_search_sorted(&b, 3), array_size(&b));
 
-  array_set(&a, std::size(origin), 42);
-  array_set(&a, -1, 42);
+  array_destroy(&b);
+  std::remove(path.c_str());
+}
 
-  EXPECT_EQ(array_size(&a), std::size(origin));
+TEST(ArrayMappedTest, Append) {
+  static const int origin[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+  const std::string path = testing::TempDir() + "array_mapped_append";
 
-  for (std::size_t i = 0; i < std::size(origin); ++i) {
-    EXPECT_EQ(array_get(&a, i), origin[i]);
-  }
+  struct array a;
+  ASSERT_TRUE(array_create_mapped(&a, path.c_str()));
+  array_push_back_n(&a, origin, 4);
+  array_sync_mapped(&a);
+  array_destroy(&a);
 
+  ASSERT_TRUE(array_open_mapped(&a, path.c_str(), true));
+  EXPECT_TRUE(array_equals(&a, origin, 4));
+  array_push_back_n(&a, origin + 4, std::size(origin) - 4);
   array_destroy(&a);
-}
 
-/*
- * array_search
- */
+  ASSERT_TRUE(array_open_mapped(&a, path.c_str(), false));
+  EXPECT_TRUE(array_equals(&a, origin, std::size(origin)));
+  array_destroy(&a);
 
-TEST(ArraySearchTest, Present) {
+  std::remove(path.c_str());
+}
+
+TEST(ArrayMappedTest, ReserveFailure) {
   static const int origin[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+  const std::string path = testing::TempDir() + "array_mapped_reserve_failure";
 
   struct array a;
-  array_create_from(&a, origin, std::size(origin));
+  ASSERT_TRUE(array_create_mapped(&a, path.c_str()));
+  array_push_back_n(&a, origin, std::size(origin));
+  size_t capacity = array_capacity(&a);
 
-  for (size_t i = 0; i < std::size(origin); ++i) {
-    size_t index = array_search(&a, origin[i]);
-    EXPECT_EQ(index, i);
-  }
+  // more than the address space can map, whether or not the file system accepts the size
+  EXPECT_FALSE(array_reserve(&a, static_cast<size_t>(1) << 60));
+  // file lengths beyond the range of off_t, or of size_t once the header is added
+  EXPECT_FALSE(array_reserve(&a, static_cast<size_t>(1) << 61));
+  EXPECT_FALSE(array_reserve(&a, SIZE_MAX / sizeof(int)));
+
+  EXPECT_EQ(array_capacity(&a), capacity);
+  EXPECT_TRUE(array_equals(&a, origin, std::size(origin)));
+  array_push_back(&a, 10);
+  EXPECT_EQ(array_get(&a, 9), 10);
 
   array_destroy(&a);
+
+  ASSERT_TRUE(array_open_mapped(&a, path.c_str(), false));
+  EXPECT_EQ(array_size(&a), std::size(origin) + 1);
+  array_destroy(&a);
+
+  std::remove(path.c_str());
 }
 
-TEST(ArraySearchTest, NotPresent) {
-  static const int origin[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+TEST(ArrayMappedTest, Invalid) {
+  const std::string path = testing::TempDir() + "array_mapped_invalid";
 
   struct array a;
-  array_create_from(&a, origin, std::size(origin));
+  EXPECT_FALSE(array_open_mapped(&a, path.c_str(), false)); // missing
 
-  size_t index = array_search(&a, -1);
-  EXPECT_EQ(index, std::size(origin));
+  FILE *file = std::fopen(path.c_str(), "w");
+  ASSERT_TRUE(file != NULL);
+  std::fputs("not an array, but long enough to hold a header of sixty-four bytes", file);
+  std::fclose(file);
 
-  array_destroy(&a);
+  EXPECT_FALSE(array_open_mapped(&a, path.c_str(), false)); // not an array file
+
+  std::remove(path.c_str());
 }
 
 /*
- * array_search_sorted
+ * array_equals
  */
 
-TEST(ArraySearchSortedTest, Present) {
-  static const int origin[] = { 1, 2, 3, 5, 6, 7, 8, 9 };
+TEST(ArrayEqualsTest, DifferentElement) {
+  static const int origin[]    = { 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+  static const int reference[] = { 1, 2, 3, 4, 5, 6, 7, 8, 10 };
 
   struct array a;
   array_create_from(&a, origin, std::size(origin));
 
-  for (size_t i = 0; i < std::size(origin); ++i) {
-    size_t index = array_search_sorted(&a, origin[i]);
-    EXPECT_EQ(index, i);
-  }
+  EXPECT_FALSE(array_equals(&a, reference, std::size(reference)));
 
   array_destroy(&a);
 }
 
-
-TEST(ArraySearchSortedTest, NotPresentBefore) {
-  static const int origin[] = { 1, 2, 3, 5, 6, 7, 8, 9 };
+TEST(ArrayEqualsTest, SizeShorter) {
+  static const int origin[]    = { 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+  static const int reference[] = { 1, 2, 3, 4, 5, 6, 7, 8 };
 
   struct array a;
   array_create_from(&a, origin, std::size(origin));
 
-  size_t index = array_search_sorted(&a, -1); // before everything
-  EXPECT_EQ(index, std::size(origin));
+  EXPECT_FALSE(array_equals(&a, reference, std::size(reference)));
 
   array_destroy(&a);
 }
 
-TEST(ArraySearchSortedTest, NotPresentAfter) {
-  static const int origin[] = { 1, 2, 3, 5, 6, 7, 8, 9 };
+TEST(ArrayEqualsTest, SizeLarger) {
+  static const int origin[]    = { 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+  static const int reference[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
 
   struct array a;
   array_create_from(&a, origin, std::size(origin));
 
-  size_t index = array_search_sorted(&a, 15); // after everything
-  EXPECT_EQ(index, std::size(origin));
+  EXPECT_FALSE(array_equals(&a, reference, std::size(reference)));
 
   array_destroy(&a);
 }
 
-TEST(ArraySearchSortedTest, NotPresentMiddle) {
-  static const int origin[] = { 1, 2, 3, 5, 6, 7, 8, 9 };
+TEST(ArrayEqualsTest, EveryInstructionSet) {
+  std::vector<int> reference(100);
 
-  struct array a;
-  array_create_from(&a, origin, std::size(origin));
+  for (int simd = ARRAY_SIMD_SCALAR; simd <= ARRAY_SIMD_AVX512; ++simd) {
+    array_set_simd(static_cast<enum array_simd>(simd));
 
-  size_t index = array_search_sorted(&a, 4); // in the middle of other elements
-  EXPECT_EQ(index, std::size(origin));
+    for (size_t size = 0; size < reference.size(); ++size) {
+      for (size_t i = 0; i < size; ++i) {
+        reference[i] = static_cast<int>(i);
+      }
 
-  array_destroy(&a);
+      struct array a;
+      array_create_from(&a, reference.data(), size);
+
+      EXPECT_TRUE(array_equals(&a, reference.data(), size));
+
+      for (size_t i = 0; i < size; ++i) {
+        reference[i] = -1;
+        EXPECT_FALSE(array_equals(&a, reference.data(), size));
+        reference[i] = static_cast<int>(i);
+      }
+
+      array_destroy(&a);
+    }
+  }
+
+  array_set_simd(ARRAY_SIMD_AVX512);
 }
 
 /*
- * array_is_sorted
+ * array_push_back
  */
 
-TEST(ArrayIsSortedTest, Empty) {
+TEST(ArrayPushBackTest, OneElement) {
   struct array a;
   array_create(&a);
+  array_push_back(&a, 1);
 
-  EXPECT_TRUE(array_is_sorted(&a));
+  EXPECT_FALSE(array_empty(&a));
+  EXPECT_TRUE(array_size(&a) == 1);
+  EXPECT_EQ(array_get(&a, 0), 1);
 
   array_destroy(&a);
 }
 
-TEST(ArrayIsSortedTest, Sorted) {
-  static const int origin[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+TEST(ArrayPushBackTest, ManyElements) {
+  static const int origin[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9 };
 
   struct array a;
-  array_create_from(&a, origin, std::size(origin));
+  array_create(&a);
 
-  EXPECT_TRUE(array_is_sorted(&a));
+  for (size_t i = 0; i < std::size(origin); ++i) {
+    array_push_back(&a, origin[i]);
+  }
 
-  array_destroy(&a);
-}
+  EXPECT_FALSE(array_empty(&a));
+  EXPECT_EQ(array_size(&a), std::size(origin));
 
-TEST(ArrayIsSortedTest, NotSorted) {
-  static const int origin[] = { 0, 1, 2, 3, 4, 5, 10, 9, 8, 7, 6 };
 
-  struct array a;
-  array_create_from(&a, origin, std::size(origin));
+  for (size_t i = 0; i < std::size(origin); ++i) {
+    EXPECT_EQ(array_get(&a, i), origin[i]);
+  }
 
-  EXPECT_FALSE(array_is_sorted(&a));
+  EXPECT_TRUE(array_equals(&a, origin, std::size(origin)));
 
   array_destroy(&a);
 }
 
-TEST(ArrayIsSortedTest, NotSortedAtTheEnd) {
-  static const int origin[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0 };
-
+TEST(ArrayPushBackTest, Stressed) {
   struct array a;
-  array_create_from(&a, origin, std::size(origin));
 
-  EXPECT_FALSE(array_is_sorted(&a));
+  array_create(&a);
+
+  for (int i = 0; i < BIG_SIZE; ++i) {
+    array_push_back(&a, i + 1);
+    EXPECT_EQ(array_size(&a), static_cast<std::size_t>(i + 1));
+  }
+
+  EXPECT_FALSE(array_empty(&a));
+
+  for (int i = 0; i < BIG_SIZE; ++i) {
+    EXPECT_EQ(array_get(&a, i), i + 1);
+  }
 
   array_destroy(&a);
 }
 
 /*
- * array_partition
+ * array_push_back_n
  */
 
-TEST(ArrayPartitionTest, WholeSorted) {
-  static const int origin[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+TEST(ArrayPushBackNTest, ManyElements) {
+  static const int origin[] = { 1, 2, 3 };
+  static const int values[] = { 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 };
+  static const int expected[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 };
 
   struct array a;
   array_create_from(&a, origin, std::size(origin));
+  array_push_back_n(&a, values, std::size(values));
 
-  ptrdiff_t p = array_partition(&a, 0, std::size(origin) - 1);
-  int pivot = array_get(&a, p);
-
-  for (ptrdiff_t i = 0; i < p; ++i) {
-    EXPECT_LT(array_get(&a, i), pivot);
-  }
-
-  for (ptrdiff_t i = p + 1; i < static_cast<ptrdiff_t>(std::size(origin)); ++i) {
-    EXPECT_GT(array_get(&a, i), pivot);
-  }
-
-  for (int val : origin) {
-    EXPECT_NE(array_search(&a, val), std::size(origin));
-  }
+  EXPECT_TRUE(array_equals(&a, expected, std::size(expected)));
 
   array_destroy(&a);
 }
 
-TEST(ArrayPartitionTest, WholeNotSorted) {
-  static const int origin[] = { 5, 4, 1, 6, 10, 3, 0, 9, 8, 2, 7 };
+TEST(ArrayPushBackNTest, FromItself) {
+  static const int origin[] = { 1, 2, 3 };
+  static const int expected[] = { 1, 2, 3, 1, 2, 3 };
 
   struct array a;
   array_create_from(&a, origin, std::size(origin));
+  array_push_back_n(&a, &a.data[0], array_size(&a));
 
-  ptrdiff_t p = array_partition(&a, 0, std::size(origin) - 1);
-  int pivot = array_get(&a, p);
+  EXPECT_TRUE(array_equals(&a, expected, std::size(expected)));
 
-  for (ptrdiff_t i = 0; i < p; ++i) {
-    EXPECT_LT(array_get(&a, i), pivot);
-  }
+  array_destroy(&a);
+}
 
-  for (ptrdiff_t i = p + 1; i < static_cast<ptrdiff_t>(std::size(origin)); ++i) {
-    EXPECT_GT(array_get(&a, i), pivot);
+TEST(ArrayPushBackNTest, Stressed) {
+  std::vector<int> values(BIG_SIZE);
+  for (int i = 0; i < BIG_SIZE; ++i) {
+    values[i] = i + 1;
   }
 
-  for (int val : origin) {
-    EXPECT_NE(array_search(&a, val), std::size(origin));
-  }
+  struct array a;
+  array_create(&a);
+  array_push_back_n(&a, values.data(), values.size());
+
+  EXPECT_TRUE(array_equals(&a, values.data(), values.size()));
 
   array_destroy(&a);
 }
 
-TEST(ArrayPartitionTest, PartNotSorted) {
-  static const int origin[] = { 5, 4, 1, 6, 10, 3, 0, 9, 8, 2, 7 };
+/*
+ * array_append_array
+ */
+
+TEST(ArrayAppendArrayTest, ManyElements) {
+  static const int origin[] = { 1, 2, 3, 4 };
+  static const int other[] = { 5, 6, 7, 8, 9 };
+  static const int expected[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9 };
 
   struct array a;
   array_create_from(&a, origin, std::size(origin));
+  struct array b;
+  array_create_from(&b, other, std::size(other));
 
-  ptrdiff_t p = array_partition(&a, 3, 8);
-  int pivot = array_get(&a, p);
-
-  for (ptrdiff_t i = 3; i < p; ++i) {
-    EXPECT_LT(array_get(&a, i), pivot);
-  }
-
-  for (ptrdiff_t i = p + 1; i < 8; ++i) {
-    EXPECT_GT(array_get(&a, i), pivot);
-  }
+  array_append_array(&a, &b);
 
-  for (int val : origin) {
-    EXPECT_NE(array_search(&a, val), std::size(origin));
-  }
+  EXPECT_TRUE(array_equals(&a, expected, std::size(expected)));
+  EXPECT_TRUE(array_equals(&b, other, std::size(other)));
 
   array_destroy(&a);
+  array_destroy(&b);
 }
 
-TEST(ArrayPartitionTest, Single) {
-  static const int origin[] = { 5, 4, 1, 6, 10, 3, 0, 9, 8, 2, 7 };
+TEST(ArrayAppendArrayTest, Itself) {
+  static const int origin[] = { 1, 2, 3, 4 };
+  static const int expected[] = { 1, 2, 3, 4, 1, 2, 3, 4 };
 
   struct array a;
   array_create_from(&a, origin, std::size(origin));
 
-  ptrdiff_t p = array_partition(&a, 5, 5);
-
-  EXPECT_EQ(p, 5);
+  array_append_array(&a, &a);
 
-  for (int val : origin) {
-    EXPECT_NE(array_search(&a, val), std::size(origin));
-  }
+  EXPECT_TRUE(array_equals(&a, expected, std::size(expected)));
 
   array_destroy(&a);
 }
 
 /*
- * array_quick_sort
+ * array_assign
  */
 
-TEST(ArrayQuickSortTest, NotSorted) {
-  static const int origin[] = { 8, 4, 1, 6, 10, 3, 0, 9, 5, 2, 7 };
+TEST(ArrayAssignTest, Larger) {
+  static const int origin[] = { 1, 2, 3 };
+  static const int values[] = { 9, 8, 7, 6, 5, 4, 3, 2, 1, 0, -1, -2 };
 
   struct array a;
   array_create_from(&a, origin, std::size(origin));
+  array_assign(&a, values, std::size(values));
 
-  EXPECT_FALSE(array_is_sorted(&a));
+  EXPECT_TRUE(array_equals(&a, values, std::size(values)));
 
-  array_quick_sort(&a);
+  array_destroy(&a);
+}
 
-  EXPECT_TRUE(array_is_sorted(&a));
-  EXPECT_EQ(array_size(&a), std::size(origin));
+TEST(ArrayAssignTest, Smaller) {
+  static const int origin[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+  static const int values[] = { 42, 43 };
 
-  for (int val : origin) {
-    EXPECT_NE(array_search(&a, val), std::size(origin));
-  }
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+  array_assign(&a, values, std::size(values));
+
+  EXPECT_TRUE(array_equals(&a, values, std::size(values)));
+
+  array_assign(&a, values, 0);
+  EXPECT_TRUE(array_empty(&a));
 
   array_destroy(&a);
 }
 
-TEST(ArrayQuickSortTest, SortedBackward) {
-  static const int origin[] = { 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0 };
+/*
+ * array_pop_back
+ */
+
+TEST(ArrayPopBackTest, OneElement) {
+  static const int origin[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9 };
 
   struct array a;
   array_create_from(&a, origin, std::size(origin));
 
-  EXPECT_FALSE(array_is_sorted(&a));
+  EXPECT_EQ(array_size(&a), std::size(origin));
 
-  array_quick_sort(&a);
+  array_pop_back(&a);
 
-  EXPECT_TRUE(array_is_sorted(&a));
-  EXPECT_EQ(array_size(&a), std::size(origin));
+  EXPECT_EQ(array_size(&a), std::size(origin) - 1);
 
-  for (int val : origin) {
-    EXPECT_NE(array_search(&a, val), std::size(origin));
+  for (std::size_t i = 0; i < std::size(origin) - 1; ++i) {
+    EXPECT_EQ(array_get(&a, i), origin[i]);
   }
 
   array_destroy(&a);
 }
 
-TEST(ArrayQuickSortTest, Sorted) {
-  static const int origin[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+TEST(ArrayPopBackTest, ManyElements) {
+  static const int origin[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9 };
 
   struct array a;
   array_create_from(&a, origin, std::size(origin));
 
-  EXPECT_TRUE(array_is_sorted(&a));
-
-  array_quick_sort(&a);
-
-  EXPECT_TRUE(array_is_sorted(&a));
   EXPECT_EQ(array_size(&a), std::size(origin));
 
-  for (int val : origin) {
-    EXPECT_NE(array_search(&a, val), std::size(origin));
+  for (std::size_t i = 0; i < std::size(origin); ++i) {
+    array_pop_back(&a);
   }
 
+  EXPECT_TRUE(array_empty(&a));
+  EXPECT_EQ(array_size(&a), 0u);
+
   array_destroy(&a);
 }
 
 /*
- * array_heap_sort
+ * array_insert
  */
 
-TEST(ArrayHeapSortTest, NotSorted) {
-  static const int origin[] = { 8, 4, 1, 6, 10, 3, 0, 9, 5, 2, 7 };
+TEST(ArrayInsertTest, Beginning) {
+  static const int origin[] = { 9, 3, 7, 2, 4, 0, 8 };
+  static const int expected[] = { 42, 9, 3, 7, 2, 4, 0, 8 };
 
   struct array a;
   array_create_from(&a, origin, std::size(origin));
 
-  EXPECT_FALSE(array_is_sorted(&a));
+  array_insert(&a, 42, 0); // insert at the beginning
+
+  EXPECT_EQ(array_size(&a), std::size(expected));
+  EXPECT_TRUE(array_equals(&a, expected, std::size(expected)));
+
+  array_destroy(&a);
+}
+
+TEST(ArrayInsertTest, Middle) {
+  static const int origin[] = { 9, 3, 7, 2, 4, 0, 8 };
+  static const int expected[] = { 9, 3, 7, 42, 2, 4, 0, 8 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  array_insert(&a, 42, 3); // insert in the middle
+
+  EXPECT_EQ(array_size(&a), std::size(expected));
+  EXPECT_TRUE(array_equals(&a, expected, std::size(expected)));
+
+  array_destroy(&a);
+}
+
+TEST(ArrayInsertTest, End) {
+  static const int origin[] = { 9, 3, 7, 2, 4, 0, 8 };
+  static const int expected[] = { 9, 3, 7, 2, 4, 0, 8, 42 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  array_insert(&a, 42, std::size(origin)); // insert at the end
+
+  EXPECT_EQ(array_size(&a), std::size(expected));
+  EXPECT_TRUE(array_equals(&a, expected, std::size(expected)));
+
+  array_destroy(&a);
+}
+
+TEST(ArrayInsertTest, Stressed) {
+  static const int origin[] = { 9, 3, 7, 2, 4, 0, 8 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  for (int i = 0; i < BIG_SIZE; ++i) {
+    array_insert(&a, i + 1, 4);
+    EXPECT_EQ(array_size(&a), std::size(origin) + i + 1);
+  }
+
+  array_destroy(&a);
+}
+
+
+/*
+ * array_remove
+ */
+
+TEST(ArrayRemoveTest, Beginning) {
+  static const int origin[] = { 9, 3, 7, 2, 4, 0, 8 };
+  static const int expected[] = { 3, 7, 2, 4, 0, 8 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  array_remove(&a, 0); // remove at the beginning
+
+  EXPECT_EQ(array_size(&a), std::size(expected));
+  EXPECT_TRUE(array_equals(&a, expected, std::size(expected)));
+
+  array_destroy(&a);
+}
+
+TEST(ArrayRemoveTest, Middle) {
+  static const int origin[] = { 9, 3, 7, 2, 4, 0, 8 };
+  static const int expected[] = { 9, 3, 7, 4, 0, 8 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  array_remove(&a, 3); // remove in the middle
+
+  EXPECT_EQ(array_size(&a), std::size(expected));
+  EXPECT_TRUE(array_equals(&a, expected, std::size(expected)));
+
+  array_destroy(&a);
+}
+
+TEST(ArrayRemoveTest, End) {
+  static const int origin[] = { 9, 3, 7, 2, 4, 0, 8 };
+  static const int expected[] = { 9, 3, 7, 2, 4, 0 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  array_remove(&a, std::size(origin) - 1); // remove at the end
+
+  EXPECT_EQ(array_size(&a), std::size(expected));
+  EXPECT_TRUE(array_equals(&a, expected, std::size(expected)));
+
+  array_destroy(&a);
+}
+
+/*
+ * array_insert_range
+ */
+
+TEST(ArrayInsertRangeTest, Middle) {
+  static const int origin[] = { 1, 2, 3, 7, 8, 9 };
+  static const int values[] = { 4, 5, 6 };
+  static const int expected[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+  array_insert_range(&a, values, std::size(values), 3);
+
+  EXPECT_TRUE(array_equals(&a, expected, std::size(expected)));
+
+  array_destroy(&a);
+}
+
+TEST(ArrayInsertRangeTest, BeginningAndEnd) {
+  static const int origin[] = { 4, 5, 6 };
+  static const int values[] = { 1, 2, 3 };
+  static const int expected[] = { 1, 2, 3, 4, 5, 6, 1, 2, 3 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+  array_insert_range(&a, values, std::size(values), 0);
+  array_insert_range(&a, values, std::size(values), array_size(&a));
+
+  EXPECT_TRUE(array_equals(&a, expected, std::size(expected)));
+
+  array_destroy(&a);
+}
+
+TEST(ArrayInsertRangeTest, FromItself) {
+  static const int origin[] = { 1, 2, 3, 4 };
+  static const int expected[] = { 1, 2, 3, 4, 2, 3, 4 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+  array_insert_range(&a, &a.data[1], 3, 1);
+
+  EXPECT_TRUE(array_equals(&a, expected, std::size(expected)));
+
+  array_destroy(&a);
+}
+
+/*
+ * array_remove_range
+ */
+
+TEST(ArrayRemoveRangeTest, Middle) {
+  static const int origin[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+  static const int expected[] = { 1, 2, 7, 8, 9 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+  array_remove_range(&a, 2, 4);
+
+  EXPECT_TRUE(array_equals(&a, expected, std::size(expected)));
+
+  array_destroy(&a);
+}
+
+TEST(ArrayRemoveRangeTest, Everything) {
+  static const int origin[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+  array_remove_range(&a, 0, std::size(origin));
+
+  EXPECT_TRUE(array_empty(&a));
+
+  array_destroy(&a);
+}
+
+/*
+ * array_remove_if
+ */
+
+static bool is_even(int value, void *user_data) {
+  int *calls = static_cast<int *>(user_data);
+
+  if (calls != NULL) {
+    (*calls)++;
+  }
+
+  return value % 2 == 0;
+}
+
+TEST(ArrayRemoveIfTest, Even) {
+  static const int origin[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+  static const int expected[] = { 1, 3, 5, 7, 9 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  int calls = 0;
+  EXPECT_EQ(array_remove_if(&a, is_even, &calls), 4u);
+  EXPECT_EQ(calls, static_cast<int>(std::size(origin)));
+
+  EXPECT_TRUE(array_equals(&a, expected, std::size(expected)));
+
+  array_destroy(&a);
+}
+
+TEST(ArrayRemoveIfTest, Nothing) {
+  static const int origin[] = { 1, 3, 5, 7, 9 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  EXPECT_EQ(array_remove_if(&a, is_even, NULL), 0u);
+  EXPECT_TRUE(array_equals(&a, origin, std::size(origin)));
+
+  array_destroy(&a);
+}
+
+/*
+ * array_retain
+ */
+
+TEST(ArrayRetainTest, Even) {
+  static const int origin[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+  static const int expected[] = { 2, 4, 6, 8 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  EXPECT_EQ(array_retain(&a, is_even, NULL), 5u);
+  EXPECT_TRUE(array_equals(&a, expected, std::size(expected)));
+
+  array_destroy(&a);
+}
+
+/*
+ * array_get
+ */
+
+TEST(ArrayGetTest, ValidIndex) {
+  static const int origin[] = { 9, 3, 7, 2, 4, 0, 8 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  for (std::size_t i = 0; i < std::size(origin); ++i) {
+    EXPECT_EQ(array_get(&a, i), origin[i]);
+  }
+
+  array_destroy(&a);
+}
+
+TEST(ArrayGetTest, NotValidIndex) {
+  static const int origin[] = { 9, 3, 7, 2, 4, 0, 8 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  EXPECT_EQ(array_get(&a, std::size(origin)), 0);
+  EXPECT_EQ(array_get(&a, -1), 0);
+
+  array_destroy(&a);
+}
+
+/*
+ * array_set
+ */
+
+TEST(ArraySetTest, ValidIndex) {
+  static const int origin[] = { 9, 3, 7, 2, 4, 0, 8 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  for (std::size_t i = 0; i < std::size(origin); ++i) {
+    array_set(&a, i, origin[i] - 1);
+    EXPECT_EQ(array_get(&a, i), origin[i] - 1);
+  }
+
+  EXPECT_EQ(array_size(&a), std::size(origin));
+
+  array_destroy(&a);
+}
+
+TEST(ArraySetTest, NotValidIndex) {
+  static const int origin[] = { 9, 3, 7, 2, 4, 0, 8 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  array_set(&a, std::size(origin), 42);
+  array_set(&a, -1, 42);
+
+  EXPECT_EQ(array_size(&a), std::size(origin));
+
+  for (std::size_t i = 0; i < std::size(origin); ++i) {
+    EXPECT_EQ(array_get(&a, i), origin[i]);
+  }
+
+  array_destroy(&a);
+}
+
+/*
+ * array_search
+ */
+
+TEST(ArraySearchTest, Present) {
+  static const int origin[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  for (size_t i = 0; i < std::size(origin); ++i) {
+    size_t index = array_search(&a, origin[i]);
+    EXPECT_EQ(index, i);
+  }
+
+  array_destroy(&a);
+}
+
+TEST(ArraySearchTest, NotPresent) {
+  static const int origin[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  size_t index = array_search(&a, -1);
+  EXPECT_EQ(index, std::size(origin));
+
+  array_destroy(&a);
+}
+
+TEST(ArraySearchTest, EveryInstructionSet) {
+  struct array a;
+  array_create(&a);
+
+  for (int i = 0; i < BIG_SIZE; ++i) {
+    array_push_back(&a, i % 97);
+  }
+
+  for (int simd = ARRAY_SIMD_SCALAR; simd <= ARRAY_SIMD_AVX512; ++simd) {
+    array_set_simd(static_cast<enum array_simd>(simd));
+
+    for (int i = 0; i < 97; ++i) {
+      EXPECT_EQ(array_search(&a, i), static_cast<size_t>(i));
+    }
+
+    EXPECT_EQ(array_search(&a, 97), static_cast<size_t>(BIG_SIZE));
+  }
+
+  array_set_simd(ARRAY_SIMD_AVX512);
+  array_destroy(&a);
+}
+
+TEST(ArraySearchTest, Tail) {
+  struct array a;
+  array_create(&a);
+
+  for (int simd = ARRAY_SIMD_SCALAR; simd <= ARRAY_SIMD_AVX512; ++simd) {
+    array_set_simd(static_cast<enum array_simd>(simd));
+
+    for (int size = 1; size < 80; ++size) {
+      array_assign(&a, NULL, 0);
+
+      for (int i = 0; i < size; ++i) {
+        array_push_back(&a, 0);
+      }
+
+      array_set(&a, size - 1, 1);
+      EXPECT_EQ(array_search(&a, 1), static_cast<size_t>(size - 1));
+      EXPECT_EQ(array_search(&a, 2), static_cast<size_t>(size));
+    }
+  }
+
+  array_set_simd(ARRAY_SIMD_AVX512);
+  array_destroy(&a);
+}
+
+/*
+ * array_count
+ */
+
+TEST(ArrayCountTest, ManyElements) {
+  static const int origin[] = { 1, 2, 1, 4, 1, 6, 7, 1, 9, 1, 1, 2, 3, 4, 5, 6, 1, 8, 9 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  for (int simd = ARRAY_SIMD_SCALAR; simd <= ARRAY_SIMD_AVX512; ++simd) {
+    array_set_simd(static_cast<enum array_simd>(simd));
+
+    EXPECT_EQ(array_count(&a, 1), 7u);
+    EXPECT_EQ(array_count(&a, 9), 2u);
+    EXPECT_EQ(array_count(&a, 10), 0u);
+  }
+
+  array_set_simd(ARRAY_SIMD_AVX512);
+  array_destroy(&a);
+}
+
+TEST(ArrayCountTest, Empty) {
+  struct array a;
+  array_create(&a);
+
+  EXPECT_EQ(array_count(&a, 0), 0u);
+
+  array_destroy(&a);
+}
+
+/*
+ * array_search_all
+ */
+
+TEST(ArraySearchAllTest, ManyElements) {
+  static const int origin[] = { 1, 2, 1, 4, 1, 6, 7, 1, 9, 1, 1, 2, 3, 4, 5, 6, 1, 8, 9 };
+  static const size_t expected[] = { 0, 2, 4, 7, 9, 10, 16 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  for (int simd = ARRAY_SIMD_SCALAR; simd <= ARRAY_SIMD_AVX512; ++simd) {
+    array_set_simd(static_cast<enum array_simd>(simd));
+
+    size_t indices[std::size(expected)];
+    EXPECT_EQ(array_search_all(&a, 1, indices, std::size(indices)), std::size(expected));
+
+    for (size_t i = 0; i < std::size(expected); ++i) {
+      EXPECT_EQ(indices[i], expected[i]);
+    }
+  }
+
+  array_set_simd(ARRAY_SIMD_AVX512);
+  array_destroy(&a);
+}
+
+TEST(ArraySearchAllTest, MoreThanMax) {
+  static const int origin[] = { 1, 2, 1, 4, 1, 6, 7, 1, 9 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  size_t indices[2];
+  EXPECT_EQ(array_search_all(&a, 1, indices, std::size(indices)), 4u);
+  EXPECT_EQ(indices[0], 0u);
+  EXPECT_EQ(indices[1], 2u);
+
+  EXPECT_EQ(array_search_all(&a, 3, indices, std::size(indices)), 0u);
+
+  array_destroy(&a);
+}
+
+/*
+ * array_search_sorted
+ */
+
+TEST(ArraySearchSortedTest, Present) {
+  static const int origin[] = { 1, 2, 3, 5, 6, 7, 8, 9 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  for (size_t i = 0; i < std::size(origin); ++i) {
+    size_t index = array_search_sorted(&a, origin[i]);
+    EXPECT_EQ(index, i);
+  }
+
+  array_destroy(&a);
+}
+
+
+TEST(ArraySearchSortedTest, NotPresentBefore) {
+  static const int origin[] = { 1, 2, 3, 5, 6, 7, 8, 9 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  size_t index = array_search_sorted(&a, -1); // before everything
+  EXPECT_EQ(index, std::size(origin));
+
+  array_destroy(&a);
+}
+
+TEST(ArraySearchSortedTest, NotPresentAfter) {
+  static const int origin[] = { 1, 2, 3, 5, 6, 7, 8, 9 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  size_t index = array_search_sorted(&a, 15); // after everything
+  EXPECT_EQ(index, std::size(origin));
+
+  array_destroy(&a);
+}
+
+TEST(ArraySearchSortedTest, NotPresentMiddle) {
+  static const int origin[] = { 1, 2, 3, 5, 6, 7, 8, 9 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  size_t index = array_search_sorted(&a, 4); // in the middle of other elements
+  EXPECT_EQ(index, std::size(origin));
+
+  array_destroy(&a);
+}
+
+TEST(ArraySearchSortedTest, Duplicates) {
+  static const int origin[] = { 1, 2, 2, 2, 5, 5, 7, 8, 9 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  EXPECT_EQ(array_search_sorted(&a, 2), 1u);
+  EXPECT_EQ(array_search_sorted(&a, 5), 4u);
+
+  array_destroy(&a);
+}
+
+/*
+ * array_search_sorted_batch
+ */
+
+TEST(ArraySearchSortedBatchTest, ManyElements) {
+  static const int origin[] = { 1, 2, 3, 5, 6, 7, 8, 9 };
+  static const int keys[] = { 9, -1, 1, 4, 5, 15, 8 };
+  static const size_t expected[] = { 7, 8, 0, 8, 3, 8, 6 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  size_t out[std::size(keys)];
+  array_search_sorted_batch(&a, keys, std::size(keys), out);
+
+  for (size_t i = 0; i < std::size(keys); ++i) {
+    EXPECT_EQ(out[i], expected[i]);
+  }
+
+  array_destroy(&a);
+}
+
+TEST(ArraySearchSortedBatchTest, Stressed) {
+  struct array a;
+  array_create(&a);
+
+  for (int i = 0; i < BIG_SIZE; ++i) {
+    array_push_back(&a, 2 * i);
+  }
+
+  std::vector<int> keys;
+  for (int i = 0; i < 3 * BIG_SIZE; ++i) {
+    keys.push_back((i * 7919) % (2 * BIG_SIZE + 10) - 5);
+  }
+
+  std::vector<size_t> out(keys.size());
+  array_search_sorted_batch(&a, keys.data(), keys.size(), out.data());
+
+  for (size_t i = 0; i < keys.size(); ++i) {
+    EXPECT_EQ(out[i], array_search_sorted(&a, keys[i]));
+  }
+
+  array_destroy(&a);
+}
+
+TEST(ArraySearchSortedBatchTest, Empty) {
+  static const int keys[] = { 1, 2, 3 };
+
+  struct array a;
+  array_create(&a);
+
+  size_t out[std::size(keys)];
+  array_search_sorted_batch(&a, keys, std::size(keys), out);
+
+  for (size_t i = 0; i < std::size(keys); ++i) {
+    EXPECT_EQ(out[i], 0u);
+  }
+
+  array_destroy(&a);
+}
+
+/*
+ * array_lower_bound
+ */
+
+TEST(ArrayLowerBoundTest, Present) {
+  static const int origin[] = { 1, 2, 2, 2, 5, 5, 7, 8, 9 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  EXPECT_EQ(array_lower_bound(&a, 1), 0u);
+  EXPECT_EQ(array_lower_bound(&a, 2), 1u);
+  EXPECT_EQ(array_lower_bound(&a, 5), 4u);
+  EXPECT_EQ(array_lower_bound(&a, 9), 8u);
+
+  array_destroy(&a);
+}
+
+TEST(ArrayLowerBoundTest, NotPresent) {
+  static const int origin[] = { 1, 2, 2, 2, 5, 5, 7, 8, 9 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  EXPECT_EQ(array_lower_bound(&a, -1), 0u); // before everything
+  EXPECT_EQ(array_lower_bound(&a, 4), 4u); // in the middle of other elements
+  EXPECT_EQ(array_lower_bound(&a, 15), std::size(origin)); // after everything
+
+  array_destroy(&a);
+}
+
+TEST(ArrayLowerBoundTest, Stressed) {
+  struct array a;
+  array_create(&a);
+
+  for (int i = 0; i < BIG_SIZE; ++i) {
+    array_push_back(&a, 2 * i);
+
+    for (int j = -1; j <= 2 * i + 1; ++j) {
+      EXPECT_EQ(array_lower_bound(&a, j), static_cast<size_t>((j + 1) / 2));
+    }
+  }
+
+  array_destroy(&a);
+}
+
+TEST(ArrayLowerBoundTest, Empty) {
+  struct array a;
+  array_create(&a);
+
+  EXPECT_EQ(array_lower_bound(&a, 0), 0u);
+  EXPECT_EQ(array_upper_bound(&a, 0), 0u);
+
+  array_destroy(&a);
+}
+
+/*
+ * array_upper_bound
+ */
+
+TEST(ArrayUpperBoundTest, ManyElements) {
+  static const int origin[] = { 1, 2, 2, 2, 5, 5, 7, 8, 9 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  EXPECT_EQ(array_upper_bound(&a, -1), 0u);
+  EXPECT_EQ(array_upper_bound(&a, 1), 1u);
+  EXPECT_EQ(array_upper_bound(&a, 2), 4u);
+  EXPECT_EQ(array_upper_bound(&a, 4), 4u);
+  EXPECT_EQ(array_upper_bound(&a, 5), 6u);
+  EXPECT_EQ(array_upper_bound(&a, 9), std::size(origin));
+
+  array_destroy(&a);
+}
+
+/*
+ * array_equal_range
+ */
+
+TEST(ArrayEqualRangeTest, ManyElements) {
+  static const int origin[] = { 1, 2, 2, 2, 5, 5, 7, 8, 9 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  size_t first, last;
+
+  array_equal_range(&a, 2, &first, &last);
+  EXPECT_EQ(first, 1u);
+  EXPECT_EQ(last, 4u);
+
+  array_equal_range(&a, 9, &first, &last);
+  EXPECT_EQ(first, 8u);
+  EXPECT_EQ(last, 9u);
+
+  array_equal_range(&a, 6, &first, &last);
+  EXPECT_EQ(first, 6u);
+  EXPECT_EQ(last, 6u);
+
+  array_destroy(&a);
+}
+
+/*
+ * array_is_sorted
+ */
+
+TEST(ArrayIsSortedTest, Empty) {
+  struct array a;
+  array_create(&a);
+
+  EXPECT_TRUE(array_is_sorted(&a));
+
+  array_destroy(&a);
+}
+
+TEST(ArrayIsSortedTest, Sorted) {
+  static const int origin[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  EXPECT_TRUE(array_is_sorted(&a));
+
+  array_destroy(&a);
+}
+
+TEST(ArrayIsSortedTest, NotSorted) {
+  static const int origin[] = { 0, 1, 2, 3, 4, 5, 10, 9, 8, 7, 6 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  EXPECT_FALSE(array_is_sorted(&a));
+
+  array_destroy(&a);
+}
+
+TEST(ArrayIsSortedTest, NotSortedAtTheEnd) {
+  static const int origin[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  EXPECT_FALSE(array_is_sorted(&a));
+
+  array_destroy(&a);
+}
+
+TEST(ArrayIsSortedTest, EveryInstructionSet) {
+  for (int simd = ARRAY_SIMD_SCALAR; simd <= ARRAY_SIMD_AVX512; ++simd) {
+    array_set_simd(static_cast<enum array_simd>(simd));
+
+    for (int size = 1; size < 100; ++size) {
+      struct array a;
+      array_create(&a);
+
+      for (int i = 0; i < size; ++i) {
+        array_push_back(&a, i / 2);
+      }
+
+      EXPECT_TRUE(array_is_sorted(&a));
+
+      for (int i = 0; i < size; ++i) {
+        array_set(&a, i, size);
+        EXPECT_EQ(array_is_sorted(&a), i == size - 1);
+        array_set(&a, i, i / 2);
+      }
+
+      array_destroy(&a);
+    }
+  }
+
+  array_set_simd(ARRAY_SIMD_AVX512);
+}
+
+/*
+ * array_partition
+ */
+
+TEST(ArrayPartitionTest, WholeSorted) {
+  static const int origin[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  ptrdiff_t p = array_partition(&a, 0, std::size(origin) - 1);
+  int pivot = array_get(&a, p);
+
+  for (ptrdiff_t i = 0; i < p; ++i) {
+    EXPECT_LT(array_get(&a, i), pivot);
+  }
+
+  for (ptrdiff_t i = p + 1; i < static_cast<ptrdiff_t>(std::size(origin)); ++i) {
+    EXPECT_GT(array_get(&a, i), pivot);
+  }
+
+  for (int val : origin) {
+    EXPECT_NE(array_search(&a, val), std::size(origin));
+  }
+
+  array_destroy(&a);
+}
+
+TEST(ArrayPartitionTest, WholeNotSorted) {
+  static const int origin[] = { 5, 4, 1, 6, 10, 3, 0, 9, 8, 2, 7 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  ptrdiff_t p = array_partition(&a, 0, std::size(origin) - 1);
+  int pivot = array_get(&a, p);
+
+  for (ptrdiff_t i = 0; i < p; ++i) {
+    EXPECT_LT(array_get(&a, i), pivot);
+  }
+
+  for (ptrdiff_t i = p + 1; i < static_cast<ptrdiff_t>(std::size(origin)); ++i) {
+    EXPECT_GT(array_get(&a, i), pivot);
+  }
+
+  for (int val : origin) {
+    EXPECT_NE(array_search(&a, val), std::size(origin));
+  }
+
+  array_destroy(&a);
+}
+
+TEST(ArrayPartitionTest, PartNotSorted) {
+  static const int origin[] = { 5, 4, 1, 6, 10, 3, 0, 9, 8, 2, 7 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  ptrdiff_t p = array_partition(&a, 3, 8);
+  int pivot = array_get(&a, p);
+
+  for (ptrdiff_t i = 3; i < p; ++i) {
+    EXPECT_LT(array_get(&a, i), pivot);
+  }
+
+  for (ptrdiff_t i = p + 1; i < 8; ++i) {
+    EXPECT_GT(array_get(&a, i), pivot);
+  }
+
+  for (int val : origin) {
+    EXPECT_NE(array_search(&a, val), std::size(origin));
+  }
+
+  array_destroy(&a);
+}
+
+TEST(ArrayPartitionTest, Single) {
+  static const int origin[] = { 5, 4, 1, 6, 10, 3, 0, 9, 8, 2, 7 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  ptrdiff_t p = array_partition(&a, 5, 5);
+
+  EXPECT_EQ(p, 5);
+
+  for (int val : origin) {
+    EXPECT_NE(array_search(&a, val), std::size(origin));
+  }
+
+  array_destroy(&a);
+}
+
+/*
+ * array_sort_small
+ */
+
+TEST(ArraySortSmallTest, AllSizes) {
+  for (int simd = ARRAY_SIMD_SCALAR; simd <= ARRAY_SIMD_AVX512; ++simd) {
+    array_set_simd(static_cast<enum array_simd>(simd));
+
+    for (size_t size = 0; size <= ARRAY_SORT_SMALL_MAX; ++size) {
+      std::vector<int> origin(size);
+      for (size_t i = 0; i < size; ++i) {
+        origin[i] = i % 5 == 0 ? INT_MAX - static_cast<int>(i % 3) : static_cast<int>((i * 7919) % 101) - 50;
+      }
+
+      std::vector<int> expected = origin;
+      std::sort(expected.begin(), expected.end());
+
+      struct array a;
+      array_create_from(&a, origin.data(), origin.size());
+
+      array_sort_small(&a);
+
+      ASSERT_TRUE(array_equals(&a, expected.data(), expected.size())) << "size " << size << ", simd " << simd;
+
+      array_destroy(&a);
+    }
+  }
+
+  array_set_simd(ARRAY_SIMD_AVX512);
+}
+
+TEST(ArraySortSmallTest, QuickSortBaseCase) {
+  std::vector<int> origin(10 * BIG_SIZE);
+  for (size_t i = 0; i < origin.size(); ++i) {
+    origin[i] = static_cast<int>((i * 2654435761LL) % 4294967291LL + INT_MIN);
+  }
+
+  std::vector<int> expected = origin;
+  std::sort(expected.begin(), expected.end());
+
+  for (int simd = ARRAY_SIMD_SCALAR; simd <= ARRAY_SIMD_AVX512; ++simd) {
+    array_set_simd(static_cast<enum array_simd>(simd));
+
+    struct array a;
+    array_create_from(&a, origin.data(), origin.size());
+
+    array_quick_sort(&a);
+
+    EXPECT_TRUE(array_equals(&a, expected.data(), expected.size()));
+
+    array_destroy(&a);
+  }
+
+  array_set_simd(ARRAY_SIMD_AVX512);
+}
+
+/*
+ * array_quick_sort
+ */
+
+TEST(ArrayQuickSortTest, NotSorted) {
+  static const int origin[] = { 8, 4, 1, 6, 10, 3, 0, 9, 5, 2, 7 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  EXPECT_FALSE(array_is_sorted(&a));
+
+  array_quick_sort(&a);
+
+  EXPECT_TRUE(array_is_sorted(&a));
+  EXPECT_EQ(array_size(&a), std::size(origin));
+
+  for (int val : origin) {
+    EXPECT_NE(array_search(&a, val), std::size(origin));
+  }
+
+  array_destroy(&a);
+}
+
+TEST(ArrayQuickSortTest, SortedBackward) {
+  static const int origin[] = { 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  EXPECT_FALSE(array_is_sorted(&a));
+
+  array_quick_sort(&a);
+
+  EXPECT_TRUE(array_is_sorted(&a));
+  EXPECT_EQ(array_size(&a), std::size(origin));
+
+  for (int val : origin) {
+    EXPECT_NE(array_search(&a, val), std::size(origin));
+  }
+
+  array_destroy(&a);
+}
+
+TEST(ArrayQuickSortTest, Sorted) {
+  static const int origin[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  EXPECT_TRUE(array_is_sorted(&a));
+
+  array_quick_sort(&a);
+
+  EXPECT_TRUE(array_is_sorted(&a));
+  EXPECT_EQ(array_size(&a), std::size(origin));
+
+  for (int val : origin) {
+    EXPECT_NE(array_search(&a, val), std::size(origin));
+  }
+
+  array_destroy(&a);
+}
+
+TEST(ArrayQuickSortTest, Empty) {
+  struct array a;
+  array_create(&a);
+
+  array_quick_sort(&a);
+
+  EXPECT_TRUE(array_empty(&a));
+
+  array_destroy(&a);
+}
+
+TEST(ArrayQuickSortTest, Patterns) {
+  static const int size = 100 * BIG_SIZE;
+
+  std::vector<std::vector<int>> patterns(6, std::vector<int>(size));
+
+  for (int i = 0; i < size; ++i) {
+    patterns[0][i] = i; // sorted
+    patterns[1][i] = size - i; // sorted backward
+    patterns[2][i] = i < size / 2 ? i : size - i; // organ pipe
+    patterns[3][i] = i % 7; // many duplicates
+    patterns[4][i] = (i * 7919) % 10007 - 5000; // pseudo random
+    patterns[5][i] = i % 1000 == 0 ? -i : i; // nearly sorted
+  }
+
+  for (auto& origin : patterns) {
+    struct array a;
+    array_create_from(&a, origin.data(), origin.size());
+
+    array_quick_sort(&a);
+
+    std::sort(origin.begin(), origin.end());
+    EXPECT_TRUE(array_equals(&a, origin.data(), origin.size()));
+
+    array_destroy(&a);
+  }
+}
+
+/*
+ * array_quick_sort_parallel
+ */
+
+TEST(ArrayQuickSortParallelTest, NotSorted) {
+  static const int origin[] = { 8, 4, 1, 6, 10, 3, 0, 9, 5, 2, 7 };
+  static const int expected[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  array_quick_sort_parallel(&a, 4);
+
+  EXPECT_TRUE(array_equals(&a, expected, std::size(expected)));
+
+  array_destroy(&a);
+}
+
+TEST(ArrayQuickSortParallelTest, Patterns) {
+  static const int size = 1024 * 1024 + 17;
+
+  std::vector<std::vector<int>> patterns(4, std::vector<int>(size));
+
+  for (int i = 0; i < size; ++i) {
+    patterns[0][i] = static_cast<int>((i * 7919LL) % 1000003) - 500000; // pseudo random
+    patterns[1][i] = size - i; // sorted backward
+    patterns[2][i] = i % 7; // many duplicates
+    patterns[3][i] = 42; // all equal
+  }
+
+  for (unsigned threads : { 0u, 1u, 3u, 8u }) {
+    for (auto& origin : patterns) {
+      struct array a;
+      array_create_from(&a, origin.data(), origin.size());
+      struct array b;
+      array_create_from(&b, origin.data(), origin.size());
+
+      array_quick_sort_parallel(&a, threads);
+      array_quick_sort(&b);
+
+      EXPECT_TRUE(array_equals(&a, &b.data[0], array_size(&b)));
+
+      array_destroy(&a);
+      array_destroy(&b);
+    }
+  }
+}
+
+/*
+ * array_sort_parallel
+ */
+
+TEST(ArraySortParallelTest, NotSorted) {
+  static const int origin[] = { 8, 4, 1, 6, 10, 3, 0, 9, 5, 2, 7 };
+  static const int expected[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  array_sort_parallel(&a, 4);
+
+  EXPECT_TRUE(array_equals(&a, expected, std::size(expected)));
+
+  array_destroy(&a);
+}
+
+TEST(ArraySortParallelTest, Patterns) {
+  static const int size = 300 * BIG_SIZE + 17;
+
+  std::vector<std::vector<int>> patterns(6, std::vector<int>(size));
+
+  for (int i = 0; i < size; ++i) {
+    patterns[0][i] = static_cast<int>((i * 7919LL) % 1000003) - 500000; // pseudo random
+    patterns[1][i] = size - i; // sorted backward
+    patterns[2][i] = i % 7; // many duplicates
+    patterns[3][i] = 42; // all equal
+    patterns[4][i] = i; // sorted
+    patterns[5][i] = i % 10 == 0 ? static_cast<int>((i * 7919LL) % 1000003) : 42; // one dominant key
+  }
+
+  for (unsigned threads : { 0u, 1u, 3u, 8u }) {
+    for (auto& origin : patterns) {
+      struct array a;
+      array_create_from(&a, origin.data(), origin.size());
+      struct array b;
+      array_create_from(&b, origin.data(), origin.size());
+
+      array_sort_parallel(&a, threads);
+      array_quick_sort(&b);
+
+      EXPECT_TRUE(array_equals(&a, &b.data[0], array_size(&b)));
+
+      array_destroy(&a);
+      array_destroy(&b);
+    }
+  }
+}
+
+/*
+ * array_stable_sort
+ */
+
+TEST(ArrayStableSortTest, NotSorted) {
+  static const int origin[] = { 8, 4, 1, 6, 10, 3, 0, 9, 5, 2, 7 };
+  static const int expected[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  array_stable_sort(&a);
+
+  EXPECT_TRUE(array_equals(&a, expected, std::size(expected)));
+
+  array_destroy(&a);
+  array_stable_sort_release_buffer();
+}
+
+TEST(ArrayStableSortTest, Patterns) {
+  static const int size = 100 * BIG_SIZE + 7;
+
+  std::vector<std::vector<int>> patterns(7, std::vector<int>(size));
+
+  for (int i = 0; i < size; ++i) {
+    patterns[0][i] = static_cast<int>((i * 7919LL) % 10007); // pseudo random
+    patterns[1][i] = size - i; // sorted backward
+    patterns[2][i] = i % 7; // many duplicates
+    patterns[3][i] = i % 1000 == 0 ? -i : i; // nearly sorted
+    patterns[4][i] = i % 5000; // long ascending runs to gallop through
+    patterns[5][i] = (i / 5000) % 2 == 0 ? i : size - i; // alternating ascending and descending runs
+    patterns[6][i] = i < size / 2 ? 2 * i : 2 * (i - size / 2) + 1; // two interleaved runs
+  }
+
+  for (auto& origin : patterns) {
+    std::vector<int> expected = origin;
+    std::sort(expected.begin(), expected.end());
+
+    struct array a;
+    array_create_from(&a, origin.data(), origin.size());
+
+    array_stable_sort(&a);
+
+    EXPECT_TRUE(array_equals(&a, expected.data(), expected.size()));
+
+    array_destroy(&a);
+  }
+
+  array_stable_sort_release_buffer();
+}
+
+TEST(ArrayStableSortTest, WithBuffer) {
+  static const int size = 10 * BIG_SIZE;
+
+  std::vector<int> origin(size);
+  for (int i = 0; i < size; ++i) {
+    origin[i] = static_cast<int>((i * 7919LL) % 1009);
+  }
+
+  std::vector<int> expected = origin;
+  std::sort(expected.begin(), expected.end());
+
+  std::vector<int> buffer(size / 2);
+
+  struct array a;
+  array_create_from(&a, origin.data(), origin.size());
+
+  array_stable_sort_with_buffer(&a, buffer.data(), buffer.size());
+
+  EXPECT_TRUE(array_equals(&a, expected.data(), expected.size()));
+
+  array_destroy(&a);
+}
+
+/*
+ * array_radix_sort
+ */
+
+TEST(ArrayRadixSortTest, NotSorted) {
+  static const int origin[] = { 8, -4, 1, 6, 10, -3, 0, 9, 5, 2, -7 };
+  static const int expected[] = { -7, -4, -3, 0, 1, 2, 5, 6, 8, 9, 10 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  array_radix_sort(&a);
+
+  EXPECT_TRUE(array_equals(&a, expected, std::size(expected)));
+
+  array_destroy(&a);
+}
+
+TEST(ArrayRadixSortTest, Extremes) {
+  static const int origin[] = { INT_MAX, 0, INT_MIN, -1, 1, INT_MIN + 1, INT_MAX - 1 };
+  static const int expected[] = { INT_MIN, INT_MIN + 1, -1, 0, 1, INT_MAX - 1, INT_MAX };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  array_radix_sort(&a);
+
+  EXPECT_TRUE(array_equals(&a, expected, std::size(expected)));
+
+  array_destroy(&a);
+}
+
+TEST(ArrayRadixSortTest, Patterns) {
+  static const int size = 100 * BIG_SIZE;
+
+  std::vector<std::vector<int>> patterns(5, std::vector<int>(size));
+
+  for (int i = 0; i < size; ++i) {
+    patterns[0][i] = static_cast<int>((i * 2654435761LL) % 4294967291LL + INT_MIN); // pseudo random over the whole range
+    patterns[1][i] = size - i; // sorted backward
+    patterns[2][i] = i % 7; // only the lowest digit differs
+    patterns[3][i] = (i % 3) << 24; // only the highest digit differs
+    patterns[4][i] = -42; // all equal
+  }
+
+  for (auto& origin : patterns) {
+    struct array a;
+    array_create_from(&a, origin.data(), origin.size());
+
+    array_radix_sort(&a);
+
+    std::sort(origin.begin(), origin.end());
+    EXPECT_TRUE(array_equals(&a, origin.data(), origin.size()));
+
+    array_destroy(&a);
+  }
+}
+
+/*
+ * array_select_kth
+ */
+
+TEST(ArraySelectKthTest, NotSorted) {
+  static const int origin[] = { 8, 4, 1, 6, 10, 3, 0, 9, 5, 2, 7 };
+
+  for (size_t k = 0; k < std::size(origin); ++k) {
+    struct array a;
+    array_create_from(&a, origin, std::size(origin));
+
+    EXPECT_EQ(array_select_kth(&a, k), static_cast<int>(k));
+
+    array_destroy(&a);
+  }
+}
+
+TEST(ArraySelectKthTest, Patterns) {
+  static const int size = 10 * BIG_SIZE + 3;
+
+  std::vector<std::vector<int>> patterns(5, std::vector<int>(size));
+
+  for (int i = 0; i < size; ++i) {
+    patterns[0][i] = (i * 7919) % 10007 - 5000; // pseudo random
+    patterns[1][i] = size - i; // sorted backward
+    patterns[2][i] = i % 7; // many duplicates
+    patterns[3][i] = 42; // all equal
+    patterns[4][i] = i < size / 2 ? i : size - i; // organ pipe
+  }
+
+  for (auto& origin : patterns) {
+    std::vector<int> sorted = origin;
+    std::sort(sorted.begin(), sorted.end());
+
+    for (size_t k : { size_t(0), size_t(1), size_t(size / 3), size_t(size / 2), size_t(size - 1) }) {
+      struct array a;
+      array_create_from(&a, origin.data(), origin.size());
+
+      EXPECT_EQ(array_select_kth(&a, k), sorted[k]);
+
+      for (size_t i = 0; i < k; ++i) {
+        ASSERT_LE(array_get(&a, i), sorted[k]);
+      }
+
+      for (size_t i = k + 1; i < sorted.size(); ++i) {
+        ASSERT_GE(array_get(&a, i), sorted[k]);
+      }
+
+      array_destroy(&a);
+    }
+  }
+}
+
+/*
+ * array_nth_element
+ */
+
+TEST(ArrayNthElementTest, Median) {
+  static const int origin[] = { 8, 4, 1, 6, 10, 3, 0, 9, 5, 2, 7 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  array_nth_element(&a, 5);
+
+  EXPECT_EQ(array_get(&a, 5), 5);
+
+  for (size_t i = 0; i < 5; ++i) {
+    EXPECT_LT(array_get(&a, i), 5);
+  }
+
+  for (int val : origin) {
+    EXPECT_NE(array_search(&a, val), std::size(origin));
+  }
+
+  array_destroy(&a);
+}
+
+/*
+ * array_partial_sort
+ */
+
+TEST(ArrayPartialSortTest, Stressed) {
+  std::vector<int> origin(BIG_SIZE);
+  for (int i = 0; i < BIG_SIZE; ++i) {
+    origin[i] = (i * 7919) % 1009;
+  }
+
+  std::vector<int> sorted = origin;
+  std::sort(sorted.begin(), sorted.end());
+
+  for (size_t k : { size_t(0), size_t(1), size_t(10), size_t(500), size_t(BIG_SIZE), size_t(BIG_SIZE + 1) }) {
+    struct array a;
+    array_create_from(&a, origin.data(), origin.size());
+
+    array_partial_sort(&a, k);
+
+    for (size_t i = 0; i < std::min(k, sorted.size()); ++i) {
+      ASSERT_EQ(array_get(&a, i), sorted[i]);
+    }
+
+    array_destroy(&a);
+  }
+}
+
+/*
+ * array_heap_sort
+ */
+
+TEST(ArrayHeapSortTest, NotSorted) {
+  static const int origin[] = { 8, 4, 1, 6, 10, 3, 0, 9, 5, 2, 7 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  EXPECT_FALSE(array_is_sorted(&a));
+
+  array_heap_sort(&a);
+
+  EXPECT_TRUE(array_is_sorted(&a));
+  EXPECT_EQ(array_size(&a), std::size(origin));
+
+  for (int val : origin) {
+    EXPECT_NE(array_search(&a, val), std::size(origin));
+  }
+
+  array_destroy(&a);
+}
+
+TEST(ArrayHeapSortTest, SortedBackward) {
+  static const int origin[] = { 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  EXPECT_FALSE(array_is_sorted(&a));
+
+  array_heap_sort(&a);
+
+  EXPECT_TRUE(array_is_sorted(&a));
+  EXPECT_EQ(array_size(&a), std::size(origin));
+
+  for (int val : origin) {
+    EXPECT_NE(array_search(&a, val), std::size(origin));
+  }
+
+  array_destroy(&a);
+}
+
+TEST(ArrayHeapSortTest, Sorted) {
+  static const int origin[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  EXPECT_TRUE(array_is_sorted(&a));
+
+  array_heap_sort(&a);
+
+  EXPECT_TRUE(array_is_sorted(&a));
+  EXPECT_EQ(array_size(&a), std::size(origin));
+
+  for (int val : origin) {
+    EXPECT_NE(array_search(&a, val), std::size(origin));
+  }
+
+  array_destroy(&a);
+}
+
+TEST(ArrayHeapSortTest, Patterns) {
+  static const int size = 10 * BIG_SIZE;
+
+  std::vector<std::vector<int>> patterns(4, std::vector<int>(size));
+
+  for (int i = 0; i < size; ++i) {
+    patterns[0][i] = (i * 7919) % 10007 - 5000; // pseudo random
+    patterns[1][i] = size - i; // sorted backward
+    patterns[2][i] = i % 7; // many duplicates
+    patterns[3][i] = i < size / 2 ? i : size - i; // organ pipe
+  }
+
+  for (auto& origin : patterns) {
+    struct array a;
+    array_create_from(&a, origin.data(), origin.size());
+
+    array_heap_sort(&a);
+
+    std::sort(origin.begin(), origin.end());
+    EXPECT_TRUE(array_equals(&a, origin.data(), origin.size()));
+
+    array_destroy(&a);
+  }
+}
+
+/*
+ * array_is_heap
+ */
+
+TEST(ArrayIsHeapTest, Empty) {
+  struct array a;
+  array_create(&a);
+
+  EXPECT_TRUE(array_is_heap(&a));
+
+  array_destroy(&a);
+}
+
+TEST(ArrayIsHeapTest, SimpleHeap1) {
+  static const int origin[] = { 13, 6, 8, 5, 3 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  EXPECT_TRUE(array_is_heap(&a));
+
+  array_destroy(&a);
+}
+
+TEST(ArrayIsHeapTest, SimpleHeap2) {
+  static const int origin[] = { 81, 45, 24, 21, 6, 17, 19, 14 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  EXPECT_TRUE(array_is_heap(&a));
+
+  array_destroy(&a);
+}
+
+TEST(ArrayIsHeapTest, NotHeap1) {
+  static const int origin[] = { 6, 5, 4, 3, 1, 8 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  EXPECT_FALSE(array_is_heap(&a));
+
+  array_destroy(&a);
+}
+
+TEST(ArrayIsHeapTest, NotHeap2) {
+  static const int origin[] = { 6, 5, 4, 3, 1, 0, 8 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  EXPECT_FALSE(array_is_heap(&a));
 
-  array_heap_sort(&a);
+  array_destroy(&a);
+}
 
-  EXPECT_TRUE(array_is_sorted(&a));
-  EXPECT_EQ(array_size(&a), std::size(origin));
+/*
+ * array_is_heap_until
+ */
 
-  for (int val : origin) {
-    EXPECT_NE(array_search(&a, val), std::size(origin));
-  }
+TEST(ArrayIsHeapUntilTest, Heap) {
+  static const int origin[] = { 81, 45, 24, 21, 6, 17, 19, 14 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  EXPECT_EQ(array_is_heap_until(&a), std::size(origin));
 
   array_destroy(&a);
 }
 
-TEST(ArrayHeapSortTest, SortedBackward) {
-  static const int origin[] = { 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0 };
+TEST(ArrayIsHeapUntilTest, NotHeap) {
+  static const int origin[] = { 6, 5, 4, 3, 1, 0, 8 };
 
   struct array a;
   array_create_from(&a, origin, std::size(origin));
 
-  EXPECT_FALSE(array_is_sorted(&a));
+  EXPECT_EQ(array_is_heap_until(&a), 6u);
 
-  array_heap_sort(&a);
+  array_destroy(&a);
+}
 
-  EXPECT_TRUE(array_is_sorted(&a));
-  EXPECT_EQ(array_size(&a), std::size(origin));
+TEST(ArrayIsHeapUntilTest, EveryInstructionSet) {
+  for (int simd = ARRAY_SIMD_SCALAR; simd <= ARRAY_SIMD_AVX512; ++simd) {
+    array_set_simd(static_cast<enum array_simd>(simd));
 
-  for (int val : origin) {
-    EXPECT_NE(array_search(&a, val), std::size(origin));
+    for (int size = 0; size < 100; ++size) {
+      struct array a;
+      array_create(&a);
+
+      for (int i = 0; i < size; ++i) {
+        array_push_back(&a, size - i);
+      }
+
+      EXPECT_EQ(array_is_heap_until(&a), static_cast<size_t>(size));
+
+      for (int i = 1; i < size; ++i) {
+        array_set(&a, i, size + 1);
+        EXPECT_EQ(array_is_heap_until(&a), static_cast<size_t>(i));
+        EXPECT_FALSE(array_is_heap(&a));
+        array_set(&a, i, size - i);
+      }
+
+      array_destroy(&a);
+    }
   }
 
-  array_destroy(&a);
+  array_set_simd(ARRAY_SIMD_AVX512);
 }
 
-TEST(ArrayHeapSortTest, Sorted) {
-  static const int origin[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+/*
+ * array_heapify
+ */
+
+TEST(ArrayHeapifyTest, NotHeap) {
+  static const int origin[] = { 6, 5, 4, 3, 1, 0, 8 };
 
   struct array a;
   array_create_from(&a, origin, std::size(origin));
 
-  EXPECT_TRUE(array_is_sorted(&a));
-
-  array_heap_sort(&a);
+  array_heapify(&a);
 
-  EXPECT_TRUE(array_is_sorted(&a));
+  EXPECT_TRUE(array_is_heap(&a));
+  EXPECT_EQ(array_heap_top(&a), 8);
   EXPECT_EQ(array_size(&a), std::size(origin));
 
   for (int val : origin) {
@@ -725,102 +2354,410 @@ TEST(ArrayHeapSortTest, Sorted) {
   array_destroy(&a);
 }
 
+TEST(ArrayHeapifyTest, Stressed) {
+  struct array a;
+  array_create(&a);
+
+  for (int i = 0; i < BIG_SIZE; ++i) {
+    array_push_back(&a, (i * 7919) % 1009);
+  }
+
+  array_heapify(&a);
+
+  EXPECT_TRUE(array_is_heap(&a));
+
+  int previous = array_heap_top(&a);
+
+  while (!array_empty(&a)) {
+    EXPECT_LE(array_heap_top(&a), previous);
+    previous = array_heap_top(&a);
+    array_heap_remove_top(&a);
+  }
+
+  array_destroy(&a);
+}
+
+TEST(ArrayHeapifyTest, Empty) {
+  struct array a;
+  array_create(&a);
+
+  array_heapify(&a);
+
+  EXPECT_TRUE(array_is_heap(&a));
+
+  array_destroy(&a);
+}
+
 /*
- * array_is_heap
+ * array_heap_add
  */
 
-TEST(ArrayIsHeapTest, Empty) {
+TEST(ArrayHeapAddTest, Stressed) {
+    struct array a;
+
+    array_create(&a);
+
+    for (int i = 0; i < BIG_SIZE; ++i) {
+        array_heap_add(&a, i);
+        EXPECT_EQ(i, array_heap_top(&a));
+        EXPECT_TRUE(array_is_heap(&a));
+    }
+
+    array_destroy(&a);
+}
+
+/*
+ * array_heap_remove_top
+ */
+
+TEST(ArrayHeapRemoveTopTest, Stressed) {
   struct array a;
+
   array_create(&a);
 
+  for (int i = 0; i < BIG_SIZE; ++i) {
+    array_heap_add(&a, i);
+  }
+
   EXPECT_TRUE(array_is_heap(&a));
 
+  for (int i = 0; i < BIG_SIZE; ++i) {
+    EXPECT_EQ(BIG_SIZE - i - 1, array_heap_top(&a));
+    array_heap_remove_top(&a);
+  }
+
+  EXPECT_TRUE(array_empty(&a));
+
   array_destroy(&a);
 }
 
-TEST(ArrayIsHeapTest, SimpleHeap1) {
-  static const int origin[] = { 13, 6, 8, 5, 3 };
+/*
+ * array_heap_replace_top
+ */
+
+TEST(ArrayHeapReplaceTopTest, Smaller) {
+  static const int origin[] = { 81, 45, 24, 21, 6, 17, 19, 14 };
 
   struct array a;
   array_create_from(&a, origin, std::size(origin));
 
+  array_heap_replace_top(&a, 20);
+
   EXPECT_TRUE(array_is_heap(&a));
+  EXPECT_EQ(array_heap_top(&a), 45);
+  EXPECT_EQ(array_size(&a), std::size(origin));
+  EXPECT_EQ(array_search(&a, 81), std::size(origin));
+  EXPECT_NE(array_search(&a, 20), std::size(origin));
 
   array_destroy(&a);
 }
 
-TEST(ArrayIsHeapTest, SimpleHeap2) {
+TEST(ArrayHeapReplaceTopTest, Larger) {
   static const int origin[] = { 81, 45, 24, 21, 6, 17, 19, 14 };
 
   struct array a;
   array_create_from(&a, origin, std::size(origin));
 
+  array_heap_replace_top(&a, 100);
+
   EXPECT_TRUE(array_is_heap(&a));
+  EXPECT_EQ(array_heap_top(&a), 100);
 
   array_destroy(&a);
 }
 
-TEST(ArrayIsHeapTest, NotHeap1) {
-  static const int origin[] = { 6, 5, 4, 3, 1, 8 };
+/*
+ * array_heap_pushpop
+ */
+
+TEST(ArrayHeapPushPopTest, Smaller) {
+  static const int origin[] = { 81, 45, 24, 21, 6, 17, 19, 14 };
 
   struct array a;
   array_create_from(&a, origin, std::size(origin));
 
-  EXPECT_FALSE(array_is_heap(&a));
+  EXPECT_EQ(array_heap_pushpop(&a, 20), 81);
+
+  EXPECT_TRUE(array_is_heap(&a));
+  EXPECT_EQ(array_heap_top(&a), 45);
+  EXPECT_EQ(array_size(&a), std::size(origin));
 
   array_destroy(&a);
 }
 
-TEST(ArrayIsHeapTest, NotHeap2) {
-  static const int origin[] = { 6, 5, 4, 3, 1, 0, 8 };
+TEST(ArrayHeapPushPopTest, Larger) {
+  static const int origin[] = { 81, 45, 24, 21, 6, 17, 19, 14 };
 
   struct array a;
   array_create_from(&a, origin, std::size(origin));
 
-  EXPECT_FALSE(array_is_heap(&a));
+  EXPECT_EQ(array_heap_pushpop(&a, 100), 100);
+  EXPECT_TRUE(array_equals(&a, origin, std::size(origin)));
+
+  array_destroy(&a);
+}
+
+TEST(ArrayHeapPushPopTest, Empty) {
+  struct array a;
+  array_create(&a);
+
+  EXPECT_EQ(array_heap_pushpop(&a, 42), 42);
+  EXPECT_TRUE(array_empty(&a));
 
   array_destroy(&a);
 }
 
 /*
- * array_heap_add
+ * array_heap_add_n
  */
 
-TEST(ArrayHeapAddTest, Stressed) {
-    struct array a;
+TEST(ArrayHeapAddNTest, Stressed) {
+  std::vector<int> values(BIG_SIZE);
+  for (int i = 0; i < BIG_SIZE; ++i) {
+    values[i] = (i * 7919) % 1009;
+  }
 
-    array_create(&a);
+  struct array a;
+  array_create(&a);
+
+  // batches large and small compared to the heap
+  for (size_t n : { 300u, 1u, 5u, 10u, 2u, 682u }) {
+    array_heap_add_n(&a, values.data() + array_size(&a), n);
+    EXPECT_TRUE(array_is_heap(&a));
+  }
+
+  EXPECT_EQ(array_size(&a), static_cast<size_t>(BIG_SIZE));
+
+  std::sort(values.begin(), values.end());
+
+  for (int i = BIG_SIZE - 1; i >= 0; --i) {
+    EXPECT_EQ(array_heap_top(&a), values[i]);
+    array_heap_remove_top(&a);
+  }
+
+  array_destroy(&a);
+}
+
+/*
+ * array_topk
+ */
+
+TEST(ArrayTopkTest, Push) {
+  static const int origin[] = { 8, 4, 1, 6, 10, 3, 0, 9, 5, 2, 7 };
+
+  struct array_topk topk;
+  array_topk_create(&topk, 3);
+
+  for (int val : origin) {
+    array_topk_push(&topk, val);
+    EXPECT_LE(array_topk_size(&topk), 3u);
+  }
+
+  EXPECT_EQ(array_topk_threshold(&topk), 8);
+
+  int out[3];
+  EXPECT_EQ(array_topk_extract_sorted(&topk, out), 3u);
+  EXPECT_EQ(out[0], 10);
+  EXPECT_EQ(out[1], 9);
+  EXPECT_EQ(out[2], 8);
+  EXPECT_EQ(array_topk_size(&topk), 0u);
+
+  array_topk_destroy(&topk);
+}
+
+TEST(ArrayTopkTest, FewerThanK) {
+  static const int origin[] = { INT_MIN, 5, INT_MAX, -3 };
+
+  struct array_topk topk;
+  array_topk_create(&topk, 10);
+
+  array_topk_push_n(&topk, origin, std::size(origin));
+
+  EXPECT_EQ(array_topk_threshold(&topk), INT_MIN);
+
+  int out[10];
+  EXPECT_EQ(array_topk_extract_sorted(&topk, out), 4u);
+  EXPECT_EQ(out[0], INT_MAX);
+  EXPECT_EQ(out[1], 5);
+  EXPECT_EQ(out[2], -3);
+  EXPECT_EQ(out[3], INT_MIN);
+
+  array_topk_destroy(&topk);
+}
+
+TEST(ArrayTopkTest, StressedPushN) {
+  std::vector<int> origin(10 * BIG_SIZE);
+  for (size_t i = 0; i < origin.size(); ++i) {
+    origin[i] = static_cast<int>((i * 7919) % 10007) - 5000;
+  }
+
+  static const size_t k = 100;
+  struct array_topk topk;
+  array_topk_create(&topk, k);
+
+  for (size_t i = 0; i < origin.size(); i += 37) {
+    array_topk_push_n(&topk, origin.data() + i, std::min<size_t>(37, origin.size() - i));
+  }
+
+  std::vector<int> expected = origin;
+  std::sort(expected.begin(), expected.end(), std::greater<int>());
+
+  std::vector<int> out(k);
+  ASSERT_EQ(array_topk_extract_sorted(&topk, out.data()), k);
+  for (size_t i = 0; i < k; ++i) {
+    EXPECT_EQ(out[i], expected[i]);
+  }
+
+  array_topk_destroy(&topk);
+}
+
+/*
+ * array_dheap
+ */
+
+TEST(ArrayDHeapTest, Empty) {
+  struct array_dheap h;
+  array_dheap_create(&h, 4);
+
+  EXPECT_TRUE(array_dheap_empty(&h));
+  EXPECT_EQ(array_dheap_size(&h), 0u);
+  EXPECT_TRUE(array_dheap_is_heap(&h));
+
+  array_dheap_destroy(&h);
+}
+
+TEST(ArrayDHeapTest, Alignment) {
+  for (unsigned arity : { 4u, 8u }) {
+    struct array_dheap h;
+    array_dheap_create(&h, arity);
 
     for (int i = 0; i < BIG_SIZE; ++i) {
-        array_heap_add(&a, i);
-        EXPECT_EQ(i, array_heap_top(&a));
-        EXPECT_TRUE(array_is_heap(&a));
+      array_dheap_add(&h, i);
     }
 
-    array_destroy(&a);
+    for (size_t i = 0; i < 10; ++i) {
+      uintptr_t first = reinterpret_cast<uintptr_t>(&h.data[arity * i + 1]);
+      uintptr_t last = reinterpret_cast<uintptr_t>(&h.data[arity * i + arity]);
+      EXPECT_EQ(first / 64, last / 64);
+    }
+
+    array_dheap_destroy(&h);
+  }
+}
+
+TEST(ArrayDHeapTest, Stressed) {
+  for (unsigned arity : { 4u, 8u }) {
+    for (int simd = ARRAY_SIMD_SCALAR; simd <= ARRAY_SIMD_AVX512; ++simd) {
+      array_set_simd(static_cast<enum array_simd>(simd));
+
+      struct array_dheap h;
+      array_dheap_create(&h, arity);
+
+      for (int i = 0; i < BIG_SIZE; ++i) {
+        array_dheap_add(&h, (i * 7919) % 1009);
+        EXPECT_TRUE(array_dheap_is_heap(&h));
+      }
+
+      EXPECT_EQ(array_dheap_size(&h), static_cast<size_t>(BIG_SIZE));
+
+      int previous = array_dheap_top(&h);
+
+      while (!array_dheap_empty(&h)) {
+        EXPECT_LE(array_dheap_top(&h), previous);
+        previous = array_dheap_top(&h);
+        array_dheap_remove_top(&h);
+      }
+
+      EXPECT_TRUE(array_dheap_is_heap(&h));
+
+      array_dheap_destroy(&h);
+    }
+  }
+
+  array_set_simd(ARRAY_SIMD_AVX512);
+}
+
+TEST(ArrayDHeapTest, NotHeap) {
+  struct array_dheap h;
+  array_dheap_create(&h, 4);
+
+  for (int i = 0; i < 10; ++i) {
+    array_dheap_add(&h, i);
+  }
+
+  h.data[7] = 100;
+  EXPECT_FALSE(array_dheap_is_heap(&h));
+
+  array_dheap_destroy(&h);
 }
 
 /*
- * array_heap_remove_top
+ * array_build_eytzinger_index
  */
 
-TEST(ArrayHeapRemoveTopTest, Stressed) {
+TEST(ArrayEytzingerTest, Present) {
+  static const int origin[] = { 1, 2, 3, 5, 6, 7, 8, 9 };
+
   struct array a;
+  array_create_from(&a, origin, std::size(origin));
+  struct array_eytzinger index;
+  array_build_eytzinger_index(&index, &a);
 
-  array_create(&a);
+  EXPECT_EQ(array_eytzinger_size(&index), std::size(origin));
 
-  for (int i = 0; i < BIG_SIZE; ++i) {
-    array_heap_add(&a, i);
+  for (size_t i = 0; i < std::size(origin); ++i) {
+    EXPECT_EQ(array_eytzinger_search(&index, origin[i]), i);
   }
 
-  EXPECT_TRUE(array_is_heap(&a));
+  array_eytzinger_destroy(&index);
+  array_destroy(&a);
+}
 
-  for (int i = 0; i < BIG_SIZE; ++i) {
-    EXPECT_EQ(BIG_SIZE - i - 1, array_heap_top(&a));
-    array_heap_remove_top(&a);
-  }
+TEST(ArrayEytzingerTest, NotPresent) {
+  static const int origin[] = { 1, 2, 3, 5, 6, 7, 8, 9 };
 
-  EXPECT_TRUE(array_empty(&a));
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+  struct array_eytzinger index;
+  array_build_eytzinger_index(&index, &a);
+
+  EXPECT_EQ(array_eytzinger_search(&index, -1), std::size(origin)); // before everything
+  EXPECT_EQ(array_eytzinger_search(&index, 4), std::size(origin)); // in the middle of other elements
+  EXPECT_EQ(array_eytzinger_search(&index, 15), std::size(origin)); // after everything
+
+  array_eytzinger_destroy(&index);
+  array_destroy(&a);
+}
+
+TEST(ArrayEytzingerTest, Empty) {
+  struct array a;
+  array_create(&a);
+  struct array_eytzinger index;
+  array_build_eytzinger_index(&index, &a);
+
+  EXPECT_EQ(array_eytzinger_search(&index, 0), 0u);
+  EXPECT_EQ(array_eytzinger_lower_bound(&index, 0), 0u);
+
+  array_eytzinger_destroy(&index);
+  array_destroy(&a);
+}
+
+TEST(ArrayEytzingerTest, Stressed) {
+  struct array a;
+  array_create(&a);
+
+  for (int size = 0; size < 200; ++size) {
+    struct array_eytzinger index;
+    array_build_eytzinger_index(&index, &a);
+
+    for (int j = -2; j <= 3 * size + 1; ++j) {
+      EXPECT_EQ(array_eytzinger_search(&index, j), array_search_sorted(&a, j));
+      EXPECT_EQ(array_eytzinger_lower_bound(&index, j), array_lower_bound(&a, j));
+    }
+
+    array_eytzinger_destroy(&index);
+    array_push_back(&a, 3 * size);
+  }
 
   array_destroy(&a);
 }